@@ -1,13 +1,150 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
 #include <formula_drawer.h>
-#include <QApplication>
 
-int main(int argc, char** argv) {
-    QApplication application(argc, argv);
-    QApplication::processEvents();
+static bool parseColor(const std::string& value, unsigned& color) {
+    if (value.size() != 6 || !std::all_of(value.begin(), value.end(), [](char c) { return std::isxdigit(static_cast<unsigned char>(c)); })) {
+        return false;
+    }
+    color = static_cast<unsigned>(std::stoul(value, nullptr, 16));
+    return true;
+}
+
+static bool parseThemes(const std::string& value, std::vector<fd::Theme>& themes) {
+    static const std::vector<fd::Theme> presets = {
+        {"light", 0x000000, 0xffffff},
+        {"dark", 0xe6e6e6, 0x1e1e1e},
+        {"contrast", 0xffffff, 0x000000},
+    };
+
+    auto stream = std::istringstream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        auto preset = std::find_if(presets.begin(), presets.end(), [&](const fd::Theme& theme) { return theme.name == item; });
+        if (preset != presets.end()) {
+            themes.push_back(*preset);
+            continue;
+        }
+
+        auto firstSeparator = item.find(':');
+        auto secondSeparator = item.find(':', firstSeparator + 1);
+        if (firstSeparator == 0 || firstSeparator == std::string::npos || secondSeparator == std::string::npos) {
+            return false;
+        }
+        unsigned foreground = 0, background = 0;
+        if (!parseColor(item.substr(firstSeparator + 1, secondSeparator - firstSeparator - 1), foreground)
+            || !parseColor(item.substr(secondSeparator + 1), background)) {
+            return false;
+        }
+        themes.push_back({item.substr(0, firstSeparator), foreground, background});
+    }
+    return true;
+}
+
+static bool parsePageSize(const std::string& value, int& width, int& height) {
+    auto separator = value.find('x');
+    if (separator == std::string::npos) {
+        return false;
+    }
+    try {
+        size_t widthLength = 0, heightLength = 0;
+        width = std::stoi(value.substr(0, separator), &widthLength);
+        height = std::stoi(value.substr(separator + 1), &heightLength);
+        return widthLength == separator && heightLength == value.size() - separator - 1 && width > 0 && height > 0;
+    } catch (const std::logic_error&) {
+        return false;
+    }
+}
+
+static int drawSheet(const std::string& listFileName, std::string outputFileName, const fd::Options& options) {
+    auto listFile = std::ifstream(listFileName);
+    if (!listFile) {
+        std::cerr << "Error: Cannot open " << listFileName << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> inputExpressions;
+    std::vector<int> lineNumbers;
+    std::string line;
+    for (int lineNumber = 1; std::getline(listFile, line); lineNumber++) {
+        if (!line.empty()) {
+            inputExpressions.push_back(line);
+            lineNumbers.push_back(lineNumber);
+        }
+    }
+
+    if (outputFileName.empty()) {
+        std::cout << "Enter output file name: ";
+        std::getline(std::cin, outputFileName);
+    }
+
+    auto sheetResult = fd::drawSheet(inputExpressions, outputFileName, options);
+    auto isSuccessful = true;
+    for (int i = 0; i < sheetResult.results.size(); i++) {
+        if (!sheetResult.results[i].accepted) {
+            for (const auto& diagnostic : sheetResult.results[i].diagnostics) {
+                std::cerr << "Error at " << lineNumbers[i] << ":" << diagnostic.column << ": " << diagnostic.message << std::endl;
+            }
+            if (sheetResult.results[i].diagnostics.empty()) {
+                std::cerr << "Error in line " << lineNumbers[i] << ": " << sheetResult.results[i].errorMessage << std::endl;
+            }
+            isSuccessful = false;
+        }
+    }
+    if (!sheetResult.errorMessage.empty()) {
+        std::cerr << "Error: " << sheetResult.errorMessage << std::endl;
+        isSuccessful = false;
+    }
+    if (isSuccessful) {
+        std::cout << "Success" << std::endl;
+    }
+    return isSuccessful ? 0 : 1;
+}
 
+static int drawBatch(const std::string& batchFileName, const fd::Options& options) {
+    auto batchFile = std::ifstream(batchFileName);
+    if (!batchFile) {
+        std::cerr << "Error: Cannot open " << batchFileName << std::endl;
+        return 1;
+    }
+
+    std::vector<fd::BatchJob> jobs;
+    std::vector<int> lineNumbers;
+    std::string line;
+    for (int lineNumber = 1; std::getline(batchFile, line); lineNumber++) {
+        if (line.empty()) {
+            continue;
+        }
+        auto separator = line.find('\t');
+        if (separator == std::string::npos) {
+            std::cerr << "Error in line " << lineNumber << ": Expected an output file name and an expression separated by a tab" << std::endl;
+            return 1;
+        }
+        jobs.push_back({line.substr(separator + 1), line.substr(0, separator)});
+        lineNumbers.push_back(lineNumber);
+    }
+
+    auto results = fd::drawBatch(jobs, options);
+    auto isSuccessful = true;
+    for (int i = 0; i < results.size(); i++) {
+        if (!results[i].accepted) {
+            std::cerr << "Error in line " << lineNumbers[i] << ": " << results[i].errorMessage << std::endl;
+            isSuccessful = false;
+        }
+    }
+    if (isSuccessful) {
+        std::cout << "Success" << std::endl;
+    }
+    return isSuccessful ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
     std::vector<std::string> arguments;
     for (int i = 1; i < argc; i++) {
         arguments.emplace_back(argv[i]);
@@ -18,29 +155,97 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    std::string inputExpression, outputFileName;
+    std::string inputExpression, inputFileName, listFileName, batchFileName, outputFileName;
+    fd::Options options;
 
-    bool isCurrentArgumentInput = false;
-    for (int i = 0; i < arguments.size(); i += 1) {
-        if (i % 2 == 0) {
-            if (arguments[i] == "-i") {
-                isCurrentArgumentInput = true;
-            } else if (arguments[i] == "-o") {
-                isCurrentArgumentInput = false;
+    for (int i = 0; i < arguments.size(); i += 2) {
+        const auto& option = arguments[i];
+        const auto& value = arguments[i + 1];
+        if (option == "-i") {
+            inputExpression = value;
+        } else if (option == "-f") {
+            inputFileName = value;
+        } else if (option == "-l") {
+            listFileName = value;
+        } else if (option == "-b") {
+            batchFileName = value;
+        } else if (option == "-a") {
+            options.archiveFileName = value;
+        } else if (option == "-y") {
+            try {
+                options.syncBatchSize = std::stoul(value);
+            } catch (const std::logic_error&) {
+                std::cerr << "Error: Incorrect count of files " << value << std::endl;
+                return 1;
+            }
+        } else if (option == "-o") {
+            outputFileName = value;
+        } else if (option == "-m") {
+            options.metricsFileName = value;
+        } else if (option == "-k") {
+            if (value == "yes") {
+                options.tokenBoxes = true;
+            } else if (value == "no") {
+                options.tokenBoxes = false;
             } else {
-                std::cerr << "Error: Unknown option " << arguments[i] << std::endl;
+                std::cerr << "Error: Expected yes or no for token boxes, got " << value << std::endl;
                 return 1;
             }
-        } else {
-            if (isCurrentArgumentInput) {
-                inputExpression = arguments[i];
+        } else if (option == "-r") {
+            if (value == "rgb") {
+                options.renderTarget = fd::RenderTarget::RGB32;
+            } else if (value == "coverage") {
+                options.renderTarget = fd::RenderTarget::COVERAGE;
             } else {
-                outputFileName = arguments[i];
+                std::cerr << "Error: Unknown render target " << value << std::endl;
+                return 1;
             }
+        } else if (option == "-s") {
+            if (value == "native") {
+                options.nativeStrokes = true;
+            } else if (value == "qt") {
+                options.nativeStrokes = false;
+            } else {
+                std::cerr << "Error: Unknown stroke rasterizer " << value << std::endl;
+                return 1;
+            }
+        } else if (option == "-t") {
+            if (!parseThemes(value, options.themes)) {
+                std::cerr << "Error: Incorrect themes " << value << std::endl;
+                return 1;
+            }
+        } else if (option == "-c") {
+            fd::setFontSnapshotFileName(value);
+        } else if (option == "-j") {
+            try {
+                options.threads = std::stoul(value);
+            } catch (const std::logic_error&) {
+                std::cerr << "Error: Incorrect count of threads " << value << std::endl;
+                return 1;
+            }
+        } else if (option == "-p") {
+            if (!parsePageSize(value, options.pageWidth, options.pageHeight)) {
+                std::cerr << "Error: Incorrect page size " << value << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Error: Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (!batchFileName.empty()) {
+        if (!options.metricsFileName.empty()) {
+            std::cerr << "Error: Metrics cannot be saved in the batch mode" << std::endl;
+            return 1;
         }
+        return drawBatch(batchFileName, options);
+    }
+    if (!listFileName.empty()) {
+        return drawSheet(listFileName, outputFileName, options);
     }
 
-    if (inputExpression.empty()) {
+    if (inputExpression.empty() && inputFileName.empty()) {
         std::cout << "Enter expression: ";
         std::getline(std::cin, inputExpression);
     }
@@ -49,12 +254,19 @@ int main(int argc, char** argv) {
         std::getline(std::cin, outputFileName);
     }
 
-    auto result = fd::drawExpression(inputExpression, outputFileName);
+    auto result = inputFileName.empty()
+        ? fd::drawExpression(inputExpression, outputFileName, options)
+        : fd::drawExpressionFile(inputFileName, outputFileName, options);
     if (result.accepted) {
         std::cout << "Success" << std::endl;
         return 0;
     } else {
-        std::cerr << "Error: " << result.errorMessage << std::endl;
+        for (const auto& diagnostic : result.diagnostics) {
+            std::cerr << "Error at " << diagnostic.line << ":" << diagnostic.column << ": " << diagnostic.message << std::endl;
+        }
+        if (result.diagnostics.empty()) {
+            std::cerr << "Error: " << result.errorMessage << std::endl;
+        }
         return 1;
     }
 }
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace fd::pipe {
+    template<typename T>
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(size_t capacity): capacity(capacity) { }
+
+        void push(T item) {
+            auto lock = std::unique_lock(mutex);
+            notFull.wait(lock, [this] { return items.size() < capacity; });
+            items.push_back(std::move(item));
+            notEmpty.notify_one();
+        }
+
+        std::optional<T> pop() {
+            auto lock = std::unique_lock(mutex);
+            notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+            if (items.empty()) {
+                return std::nullopt;
+            }
+            auto item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return item;
+        }
+
+        void close() {
+            auto lock = std::lock_guard(mutex);
+            closed = true;
+            notEmpty.notify_all();
+        }
+
+    private:
+        size_t capacity;
+        std::deque<T> items;
+        bool closed = false;
+        std::mutex mutex;
+        std::condition_variable notFull, notEmpty;
+    };
+}
@@ -37,25 +37,29 @@ std::unique_ptr<fd::v::View> fd::exp::Index::createView() {
     return std::make_unique<fd::v::HorizontalLayout>(std::move(elements));
 }
 
-fd::exp::Unary::Unary(std::string sign, std::unique_ptr<Expression> base):
-    sign(std::move(sign)), base(std::move(base)) { }
+fd::exp::Unary::Unary(fd::sym::Symbol sign, std::unique_ptr<Expression> base):
+    sign(sign), base(std::move(base)) { }
 
 std::unique_ptr<fd::v::View> fd::exp::Unary::createView() {
     auto elements = std::vector<std::unique_ptr<fd::v::View>>();
-    elements.push_back(std::make_unique<fd::v::TextView>(sign));
+    elements.push_back(std::make_unique<fd::v::SymbolView>(sign));
     elements.push_back(base->createView());
-    return std::make_unique<fd::v::HorizontalLayout>(std::move(elements));
+    auto layout = std::make_unique<fd::v::HorizontalLayout>(std::move(elements));
+    layout->isOperatorChain = true;
+    return layout;
 }
 
-fd::exp::Binary::Binary(std::string sign, std::unique_ptr<Expression> left, std::unique_ptr<Expression> right):
-    sign(std::move(sign)), left(std::move(left)), right(std::move(right)) { }
+fd::exp::Binary::Binary(fd::sym::Symbol sign, std::unique_ptr<Expression> left, std::unique_ptr<Expression> right):
+    sign(sign), left(std::move(left)), right(std::move(right)) { }
 
 std::unique_ptr<fd::v::View> fd::exp::Binary::createView() {
     auto elements = std::vector<std::unique_ptr<fd::v::View>>();
     elements.push_back(left->createView());
-    elements.push_back(std::make_unique<fd::v::TextView>(sign));
+    elements.push_back(std::make_unique<fd::v::SymbolView>(sign));
     elements.push_back(right->createView());
-    return std::make_unique<fd::v::HorizontalLayout>(std::move(elements));
+    auto layout = std::make_unique<fd::v::HorizontalLayout>(std::move(elements));
+    layout->isOperatorChain = true;
+    return layout;
 }
 
 fd::exp::Division::Division(std::unique_ptr<Expression> top, std::unique_ptr<Expression> bottom):
@@ -65,14 +69,14 @@ std::unique_ptr<fd::v::View> fd::exp::Division::createView() {
     return std::make_unique<fd::v::FractionLayout>(top->createView(), bottom->createView());
 }
 
-fd::exp::Variadic::Variadic(std::string sign, std::unique_ptr<Expression> from, std::unique_ptr<Expression> to, std::unique_ptr<Expression> body):
-    sign(std::move(sign)), from(std::move(from)), to(std::move(to)), body(std::move(body)) { }
+fd::exp::Variadic::Variadic(fd::sym::Symbol sign, std::unique_ptr<Expression> from, std::unique_ptr<Expression> to, std::unique_ptr<Expression> body):
+    sign(sign), from(std::move(from)), to(std::move(to)), body(std::move(body)) { }
 
 std::unique_ptr<fd::v::View> fd::exp::Variadic::createView() {
     auto elements = std::vector<std::unique_ptr<fd::v::View>>();
     elements.push_back(std::make_unique<fd::v::TripleVerticalLayout>(
         std::make_unique<fd::v::SmallLayout>(to->createView(), fd::v::SmallLayoutType::NONE),
-        std::make_unique<fd::v::TextView>(sign, true),
+        std::make_unique<fd::v::SymbolView>(sign),
         std::make_unique<fd::v::SmallLayout>(from->createView(), fd::v::SmallLayoutType::NONE)
     ));
     elements.push_back(body->createView());
@@ -90,12 +94,12 @@ std::unique_ptr<fd::v::View> fd::exp::Cases::createView() {
     for (int i = 0; i < cases.size(); i++) {
         auto bodyElements = std::vector<std::unique_ptr<fd::v::View>>();
         bodyElements.push_back(cases[i].body->createView());
-        bodyElements.push_back(std::make_unique<fd::v::TextView>(","));
+        bodyElements.push_back(std::make_unique<fd::v::SymbolView>(fd::sym::Symbol::COMMA));
 
         auto conditionElements = std::vector<std::unique_ptr<fd::v::View>>();
-        conditionElements.push_back(std::make_unique<fd::v::TextView>("if "));
+        conditionElements.push_back(std::make_unique<fd::v::SymbolView>(fd::sym::Symbol::IF));
         conditionElements.push_back(cases[i].condition->createView());
-        conditionElements.push_back(std::make_unique<fd::v::TextView>(i < cases.size() - 1 ? ";" : "."));
+        conditionElements.push_back(std::make_unique<fd::v::SymbolView>(i < cases.size() - 1 ? fd::sym::Symbol::SEMICOLON : fd::sym::Symbol::PERIOD));
 
         auto elements = std::vector<std::unique_ptr<fd::v::View>>();
         elements.push_back(std::make_unique<fd::v::HorizontalLayout>(std::move(bodyElements)));
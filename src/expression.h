@@ -4,6 +4,7 @@
 #include <memory>
 #include <vector>
 #include "view.h"
+#include "symbol.h"
 
 namespace fd::exp {
     class Expression {
@@ -52,21 +53,21 @@ namespace fd::exp {
 
     class Unary : public Expression {
     public:
-        std::string sign;
+        fd::sym::Symbol sign;
         std::unique_ptr<Expression> base;
 
-        Unary(std::string sign, std::unique_ptr<Expression> base);
+        Unary(fd::sym::Symbol sign, std::unique_ptr<Expression> base);
 
         std::unique_ptr<fd::v::View> createView() override;
     };
 
     class Binary : public Expression {
     public:
-        std::string sign;
+        fd::sym::Symbol sign;
         std::unique_ptr<Expression> left;
         std::unique_ptr<Expression> right;
 
-        Binary(std::string sign, std::unique_ptr<Expression> left, std::unique_ptr<Expression> right);
+        Binary(fd::sym::Symbol sign, std::unique_ptr<Expression> left, std::unique_ptr<Expression> right);
 
         std::unique_ptr<fd::v::View> createView() override;
     };
@@ -83,12 +84,12 @@ namespace fd::exp {
 
     class Variadic : public Expression {
     public:
-        std::string sign;
+        fd::sym::Symbol sign;
         std::unique_ptr<Expression> from;
         std::unique_ptr<Expression> to;
         std::unique_ptr<Expression> body;
 
-        Variadic(std::string sign, std::unique_ptr<Expression> from, std::unique_ptr<Expression> to, std::unique_ptr<Expression> body);
+        Variadic(fd::sym::Symbol sign, std::unique_ptr<Expression> from, std::unique_ptr<Expression> to, std::unique_ptr<Expression> body);
 
         std::unique_ptr<fd::v::View> createView() override;
     };
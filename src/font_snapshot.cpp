@@ -0,0 +1,275 @@
+#include "font_snapshot.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <set>
+#include <vector>
+#include <QFontMetricsF>
+#include <QSaveFile>
+
+// Must be changed whenever the layout of the file or the fonts of the views change
+static constexpr uint32_t snapshotVersion = 2;
+static constexpr char snapshotMagic[4] = {'F', 'D', 'F', 'S'};
+
+namespace {
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t fontOffsets[2];
+    };
+}
+
+struct fd::font::FontSnapshot::FontHeader {
+    float height, ascent;
+    uint32_t glyphsCount;
+    uint32_t glyphsOffset;
+    uint32_t kerningOffset;
+    uint32_t elementsOffset;
+};
+
+struct fd::font::FontSnapshot::Glyph {
+    uint32_t codePoint;
+    float advance, inkX, inkWidth;
+    uint32_t firstElement, elementsCount;
+};
+
+struct fd::font::FontSnapshot::Element {
+    int32_t type;
+    float x, y;
+};
+
+fd::font::FontSnapshot::FontSnapshot(const std::string& fileName):
+    file(QString::fromStdString(fileName)) { }
+
+fd::font::FontSnapshot::~FontSnapshot() {
+    if (data) {
+        file.unmap(const_cast<uchar*>(data));
+    }
+}
+
+static bool fitsIn(uint64_t size, uint64_t offset, uint64_t length) {
+    return offset <= size && length <= size - offset;
+}
+
+static bool isAligned(uint32_t offset) {
+    return offset % alignof(uint32_t) == 0;
+}
+
+std::unique_ptr<fd::font::FontSnapshot> fd::font::FontSnapshot::load(const std::string& fileName) {
+    auto snapshot = std::unique_ptr<FontSnapshot>(new FontSnapshot(fileName));
+    if (!snapshot->file.open(QIODevice::ReadOnly) || snapshot->file.size() < static_cast<qint64>(sizeof(FileHeader))) {
+        return nullptr;
+    }
+    auto size = static_cast<size_t>(snapshot->file.size());
+    snapshot->data = snapshot->file.map(0, snapshot->file.size());
+    if (!snapshot->data) {
+        return nullptr;
+    }
+
+    auto header = reinterpret_cast<const FileHeader*>(snapshot->data);
+    if (std::memcmp(header->magic, snapshotMagic, sizeof(snapshotMagic)) != 0 || header->version != snapshotVersion) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < snapshot->fonts.size(); i++) {
+        if (!fitsIn(size, header->fontOffsets[i], sizeof(FontHeader)) || !isAligned(header->fontOffsets[i])) {
+            return nullptr;
+        }
+        auto font = reinterpret_cast<const FontHeader*>(snapshot->data + header->fontOffsets[i]);
+        // Glyphs are indexed by 16-bit code points, which also keeps the size of the kerning table from overflowing
+        auto glyphsCount = static_cast<uint64_t>(font->glyphsCount);
+        if (glyphsCount > 0x10000 || !isAligned(font->glyphsOffset) || !isAligned(font->kerningOffset) || !isAligned(font->elementsOffset)
+            || !fitsIn(size, font->glyphsOffset, glyphsCount * sizeof(Glyph))
+            || !fitsIn(size, font->kerningOffset, glyphsCount * glyphsCount * sizeof(float))
+            || font->elementsOffset > size) {
+            return nullptr;
+        }
+        auto glyphs = reinterpret_cast<const Glyph*>(snapshot->data + font->glyphsOffset);
+        for (uint32_t j = 0; j < font->glyphsCount; j++) {
+            auto elementsEnd = static_cast<uint64_t>(glyphs[j].firstElement) + glyphs[j].elementsCount;
+            if (!fitsIn(size, font->elementsOffset, elementsEnd * sizeof(Element))) {
+                return nullptr;
+            }
+        }
+        snapshot->fonts[i] = font;
+    }
+    return snapshot;
+}
+
+template<typename T>
+static uint32_t append(QByteArray& bytes, const T* values, size_t count) {
+    auto offset = static_cast<uint32_t>(bytes.size());
+    bytes.append(reinterpret_cast<const char*>(values), static_cast<int>(count * sizeof(T)));
+    return offset;
+}
+
+bool fd::font::FontSnapshot::save(const std::string& fileName, const std::array<QFont, 2>& fonts, const std::array<QString, 2>& texts) {
+    auto bytes = QByteArray(sizeof(FileHeader), '\0');
+    auto header = FileHeader();
+    std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = snapshotVersion;
+
+    for (size_t i = 0; i < fonts.size(); i++) {
+        auto fontMetrics = QFontMetricsF(fonts[i]);
+        auto characters = std::set<ushort>();
+        for (auto character : texts[i]) {
+            characters.insert(character.unicode());
+        }
+
+        auto glyphs = std::vector<Glyph>();
+        auto elements = std::vector<Element>();
+        for (auto codePoint : characters) {
+            auto character = QChar(codePoint);
+            auto path = QPainterPath();
+            path.addText(0, 0, fonts[i], character);
+
+            auto glyph = Glyph();
+            glyph.codePoint = codePoint;
+            glyph.advance = static_cast<float>(fontMetrics.horizontalAdvance(character));
+            glyph.inkX = static_cast<float>(fontMetrics.boundingRect(character).x());
+            glyph.inkWidth = static_cast<float>(fontMetrics.boundingRect(character).width());
+            glyph.firstElement = static_cast<uint32_t>(elements.size());
+            glyph.elementsCount = static_cast<uint32_t>(path.elementCount());
+            for (int j = 0; j < path.elementCount(); j++) {
+                auto element = path.elementAt(j);
+                elements.push_back({static_cast<int32_t>(element.type), static_cast<float>(element.x), static_cast<float>(element.y)});
+            }
+            glyphs.push_back(glyph);
+        }
+
+        auto kerning = std::vector<float>();
+        for (const auto& left : glyphs) {
+            for (const auto& right : glyphs) {
+                auto pair = QString(QChar(left.codePoint)) + QChar(right.codePoint);
+                kerning.push_back(static_cast<float>(fontMetrics.horizontalAdvance(pair)) - left.advance - right.advance);
+            }
+        }
+
+        auto font = FontHeader();
+        font.height = static_cast<float>(fontMetrics.height());
+        font.ascent = static_cast<float>(fontMetrics.ascent());
+        font.glyphsCount = static_cast<uint32_t>(glyphs.size());
+        font.glyphsOffset = append(bytes, glyphs.data(), glyphs.size());
+        font.kerningOffset = append(bytes, kerning.data(), kerning.size());
+        font.elementsOffset = append(bytes, elements.data(), elements.size());
+        header.fontOffsets[i] = append(bytes, &font, 1);
+    }
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    auto file = QSaveFile(QString::fromStdString(fileName));
+    return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size() && file.commit();
+}
+
+const fd::font::FontSnapshot::FontHeader& fd::font::FontSnapshot::getFontHeader(fd::sym::Font font) const {
+    return *fonts[static_cast<size_t>(font)];
+}
+
+int fd::font::FontSnapshot::findGlyph(fd::sym::Font font, QChar character) const {
+    const auto& header = getFontHeader(font);
+    auto begin = reinterpret_cast<const Glyph*>(data + header.glyphsOffset);
+    auto end = begin + header.glyphsCount;
+    auto glyph = std::lower_bound(begin, end, character.unicode(), [](const Glyph& glyph, ushort codePoint) {
+        return glyph.codePoint < codePoint;
+    });
+    return glyph != end && glyph->codePoint == character.unicode() ? static_cast<int>(glyph - begin) : -1;
+}
+
+const fd::font::FontSnapshot::Glyph& fd::font::FontSnapshot::getGlyph(fd::sym::Font font, int index) const {
+    return reinterpret_cast<const Glyph*>(data + getFontHeader(font).glyphsOffset)[index];
+}
+
+qreal fd::font::FontSnapshot::getKerning(fd::sym::Font font, int left, int right) const {
+    const auto& header = getFontHeader(font);
+    return reinterpret_cast<const float*>(data + header.kerningOffset)[left * header.glyphsCount + right];
+}
+
+bool fd::font::FontSnapshot::covers(fd::sym::Font font, const QString& text) const {
+    return std::all_of(text.begin(), text.end(), [&](QChar character) {
+        return findGlyph(font, character) >= 0;
+    });
+}
+
+qreal fd::font::FontSnapshot::getHeight(fd::sym::Font font) const {
+    return getFontHeader(font).height;
+}
+
+qreal fd::font::FontSnapshot::getAscent(fd::sym::Font font) const {
+    return getFontHeader(font).ascent;
+}
+
+qreal fd::font::FontSnapshot::getBoundingWidth(fd::sym::Font font, const QString& text) const {
+    if (text.isEmpty()) {
+        return 0;
+    }
+    qreal pen = 0, left = std::numeric_limits<qreal>::max(), right = std::numeric_limits<qreal>::lowest();
+    int previous = -1;
+    for (auto character : text) {
+        auto index = findGlyph(font, character);
+        const auto& glyph = getGlyph(font, index);
+        if (previous >= 0) {
+            pen += getKerning(font, previous, index);
+        }
+        left = std::min(left, pen + glyph.inkX);
+        right = std::max(right, pen + glyph.inkX + glyph.inkWidth);
+        pen += glyph.advance;
+        previous = index;
+    }
+    return right - left;
+}
+
+qreal fd::font::FontSnapshot::getAdvanceWidth(fd::sym::Font font, const QString& text) const {
+    qreal pen = 0;
+    int previous = -1;
+    for (auto character : text) {
+        auto index = findGlyph(font, character);
+        if (previous >= 0) {
+            pen += getKerning(font, previous, index);
+        }
+        pen += getGlyph(font, index).advance;
+        previous = index;
+    }
+    return pen;
+}
+
+QPainterPath fd::font::FontSnapshot::getTextPath(fd::sym::Font font, const QString& text) const {
+    const auto& header = getFontHeader(font);
+    auto elements = reinterpret_cast<const Element*>(data + header.elementsOffset);
+    auto path = QPainterPath();
+    path.setFillRule(Qt::WindingFill);
+    qreal pen = 0;
+    int previous = -1;
+    for (auto character : text) {
+        auto index = findGlyph(font, character);
+        const auto& glyph = getGlyph(font, index);
+        if (previous >= 0) {
+            pen += getKerning(font, previous, index);
+        }
+        for (uint32_t i = glyph.firstElement; i < glyph.firstElement + glyph.elementsCount; i++) {
+            const auto& element = elements[i];
+            switch (element.type) {
+                case QPainterPath::MoveToElement:
+                    path.moveTo(pen + element.x, element.y);
+                    break;
+                case QPainterPath::LineToElement:
+                    path.lineTo(pen + element.x, element.y);
+                    break;
+                case QPainterPath::CurveToElement:
+                    // A curve is stored as its first control point followed by two data elements
+                    if (i + 2 < glyph.firstElement + glyph.elementsCount) {
+                        path.cubicTo(
+                            pen + element.x, element.y,
+                            pen + elements[i + 1].x, elements[i + 1].y,
+                            pen + elements[i + 2].x, elements[i + 2].y
+                        );
+                    }
+                    i += 2;
+                    break;
+                default:
+                    break;
+            }
+        }
+        pen += glyph.advance;
+        previous = index;
+    }
+    return path;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <QFile>
+#include <QFont>
+#include <QPainterPath>
+#include <QString>
+#include "symbol.h"
+
+namespace fd::font {
+    class FontSnapshot {
+    public:
+        static std::unique_ptr<FontSnapshot> load(const std::string& fileName);
+
+        static bool save(const std::string& fileName, const std::array<QFont, 2>& fonts, const std::array<QString, 2>& texts);
+
+        bool covers(fd::sym::Font font, const QString& text) const;
+
+        qreal getHeight(fd::sym::Font font) const;
+        qreal getAscent(fd::sym::Font font) const;
+
+        qreal getBoundingWidth(fd::sym::Font font, const QString& text) const;
+
+        qreal getAdvanceWidth(fd::sym::Font font, const QString& text) const;
+
+        QPainterPath getTextPath(fd::sym::Font font, const QString& text) const;
+
+        ~FontSnapshot();
+
+    private:
+        struct FontHeader;
+        struct Glyph;
+        struct Element;
+
+        QFile file;
+        const uchar* data = nullptr;
+        std::array<const FontHeader*, 2> fonts = {};
+
+        explicit FontSnapshot(const std::string& fileName);
+
+        const FontHeader& getFontHeader(fd::sym::Font font) const;
+        int findGlyph(fd::sym::Font font, QChar character) const;
+        const Glyph& getGlyph(fd::sym::Font font, int index) const;
+        qreal getKerning(fd::sym::Font font, int left, int right) const;
+    };
+}
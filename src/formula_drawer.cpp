@@ -1,59 +1,493 @@
 #include "formula_drawer.h"
 #include "expression.h"
+#include "image_pool.h"
+#include "rasterizer.h"
+#include "bounded_queue.h"
+#include "output_writer.h"
+#include <cmath>
 #include <cstdarg>
+#include <thread>
 #include <parser.h>
 
-extern void yy_set_input_string(const char*);
+extern void yy_set_input(const char*, size_t);
 extern void yy_clear_buffer();
 
 static fd::Result result;
-static std::string fileName;
+static std::unique_ptr<fd::exp::Expression> acceptedExpression;
+static fd::img::ImagePool imagePool;
 
-fd::Result fd::drawExpression(const std::string& inputExpression, const std::string& outputFileName) {
+// Images lower than this are drawn by a single thread, smaller bands would cost more than they save
+static constexpr int minBandHeight = 256;
+static constexpr int sheetSpacing = 8;
+static constexpr size_t pipelineQueueCapacity = 4;
+
+static void setUpPainter(QPainter& painter) {
+    auto pen = QPen(QColor(0, 0, 0));
+    pen.setWidthF(4);
+    painter.setPen(pen);
+    painter.setRenderHint(QPainter::Antialiasing);
+}
+
+static fd::img::PooledImage createImage(int width, int height, fd::RenderTarget target) {
+    if (target == fd::RenderTarget::COVERAGE) {
+        auto pooledImage = imagePool.acquire(width, height, QImage::Format_Alpha8);
+        pooledImage.image.fill(0);
+        return pooledImage;
+    }
+    auto pooledImage = imagePool.acquire(width, height, QImage::Format_RGB32);
+    pooledImage.image.fill(QColor(255, 255, 255));
+    return pooledImage;
+}
+
+static QVector<QRgb> createPalette(QRgb foreground, QRgb background) {
+    auto palette = QVector<QRgb>();
+    palette.reserve(256);
+    auto blend = [](int from, int to, int coverage) {
+        return from + ((to - from) * coverage + 127) / 255;
+    };
+    for (int coverage = 0; coverage < 256; coverage++) {
+        palette.push_back(qRgb(
+            blend(qRed(background), qRed(foreground), coverage),
+            blend(qGreen(background), qGreen(foreground), coverage),
+            blend(qBlue(background), qBlue(foreground), coverage)
+        ));
+    }
+    return palette;
+}
+
+static const QVector<QRgb>& getGrayPalette() {
+    static const auto palette = createPalette(qRgb(0, 0, 0), qRgb(255, 255, 255));
+    return palette;
+}
+
+static bool writeImage(QImageWriter& writer, QImage& image, const QVector<QRgb>& palette = getGrayPalette()) {
+    if (image.format() != QImage::Format_Alpha8) {
+        return writer.write(image);
+    }
+
+    auto indexedImage = QImage(image.bits(), image.width(), image.height(), image.bytesPerLine(), QImage::Format_Indexed8);
+    indexedImage.setColorTable(palette);
+    return writer.write(indexedImage);
+}
+
+static void drawView(const fd::v::View& view, QImage& image, unsigned threads, bool nativeStrokes) {
+    auto bandsCount = std::max(1, std::min(static_cast<int>(threads), image.height() / minBandHeight));
+    // Non-const QImage accessors detach the image, so the bands must not call them concurrently
+    auto bits = image.bits();
+    auto bytesPerLine = image.bytesPerLine();
+    auto drawBand = [&](int band) {
+        auto top = image.height() * band / bandsCount;
+        auto bottom = image.height() * (band + 1) / bandsCount;
+        auto bandBits = bits + static_cast<ptrdiff_t>(top) * bytesPerLine;
+        auto bandImage = QImage(bandBits, image.width(), bottom - top, bytesPerLine, image.format());
+        auto rasterizer = fd::rast::StrokeRasterizer(bandBits, image.width(), bottom - top, bytesPerLine);
+        auto rasterizerScope = fd::rast::RasterizerScope(nativeStrokes ? &rasterizer : nullptr);
+        auto painter = QPainter(&bandImage);
+        setUpPainter(painter);
+        painter.translate(0, -top);
+        if (bandsCount > 1) {
+            painter.setClipRect(QRectF(0, top, image.width(), bottom - top));
+        }
+        view.draw(painter);
+    };
+
+    auto workers = std::vector<std::thread>();
+    for (int band = 1; band < bandsCount; band++) {
+        workers.emplace_back(drawBand, band);
+    }
+    drawBand(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+static QSize getImageSize(const fd::v::View& view) {
+    return QSize(static_cast<int>(std::ceil(view.w)), static_cast<int>(std::ceil(view.h)));
+}
+
+static std::string siblingFileName(const std::string& fileName, const std::string& postfix, const std::string& suffix = "") {
+    auto fileInfo = QFileInfo(QString::fromStdString(fileName));
+    auto name = fileInfo.completeBaseName() + QString::fromStdString(postfix);
+    auto extension = suffix.empty() ? fileInfo.suffix() : QString::fromStdString(suffix);
+    if (!extension.isEmpty()) {
+        name += "." + extension;
+    }
+    return fileInfo.dir().filePath(name).toStdString();
+}
+
+static void collectTokenBoxes(const fd::v::View& view, qreal x, qreal y, std::vector<fd::Box>& boxes) {
+    auto horizontalLayout = dynamic_cast<const fd::v::HorizontalLayout*>(&view);
+    if (!horizontalLayout || !horizontalLayout->isOperatorChain) {
+        boxes.push_back({x, y, view.w, view.h, view.cy});
+        return;
+    }
+    for (const auto& child : horizontalLayout->children) {
+        collectTokenBoxes(*child, x + child->x, y + child->y, boxes);
+    }
+}
+
+static QJsonObject toJson(const fd::Result& result) {
+    auto metrics = QJsonObject();
+    metrics["width"] = result.width;
+    metrics["height"] = result.height;
+    metrics["cy"] = result.cy;
+    if (!result.boxes.empty()) {
+        auto boxes = QJsonArray();
+        for (const auto& box : result.boxes) {
+            boxes.append(QJsonObject{{"x", box.x}, {"y", box.y}, {"width", box.width}, {"height", box.height}, {"cy", box.cy}});
+        }
+        metrics["boxes"] = boxes;
+    }
+    return metrics;
+}
+
+static bool saveJson(const std::string& fileName, const QJsonObject& object) {
+    auto file = QFile(QString::fromStdString(fileName));
+    auto bytes = QJsonDocument(object).toJson();
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size()) {
+        return false;
+    }
+    file.close();
+    return file.error() == QFileDevice::NoError;
+}
+
+static std::unique_ptr<fd::v::View> parseView(std::string_view inputExpression, const fd::Options& options) {
 #if YYDEBUG
     yydebug = 1;
 #endif
 
-    fileName = outputFileName;
+    result = fd::Result();
 
-    yy_set_input_string(inputExpression.c_str());
+    yy_set_input(inputExpression.data(), inputExpression.size());
     yyparse();
     yy_clear_buffer();
 
+    auto expression = std::move(acceptedExpression);
+    result.accepted = expression && result.diagnostics.empty();
+    if (!result.accepted) {
+        return nullptr;
+    }
+
+    auto view = expression->createView();
+    view->measure();
+    view->layout();
+
+    auto size = getImageSize(*view);
+    result.width = size.width();
+    result.height = size.height();
+    result.cy = view->cy;
+    if (options.tokenBoxes) {
+        collectTokenBoxes(*view, 0, 0, result.boxes);
+    }
+    return view;
+}
+
+bool fd::setFontSnapshotFileName(const std::string& fileName) {
+    return fd::v::setFontSnapshotFileName(fileName);
+}
+
+fd::Result fd::drawExpression(std::string_view inputExpression, const std::string& outputFileName, const Options& options) {
+    fd::v::setThreadsCount(options.threads);
+
+    auto view = parseView(inputExpression, options);
+    if (view) {
+        auto target = options.themes.empty() ? options.renderTarget : fd::RenderTarget::COVERAGE;
+        auto pooledImage = createImage(result.width, result.height, target);
+        drawView(*view, pooledImage.image, options.threads, options.nativeStrokes && target == fd::RenderTarget::COVERAGE);
+
+        auto writer = QImageWriter();
+        writer.setFormat("png");
+        writer.setQuality(100);
+        if (options.themes.empty()) {
+            writer.setFileName(QString::fromStdString(outputFileName));
+            writeImage(writer, pooledImage.image);
+        }
+        for (const auto& theme : options.themes) {
+            writer.setFileName(QString::fromStdString(siblingFileName(outputFileName, "-" + theme.name)));
+            writeImage(writer, pooledImage.image, createPalette(theme.foreground, theme.background));
+        }
+        if (!options.metricsFileName.empty()) {
+            saveJson(options.metricsFileName, toJson(result));
+        }
+    }
+
     return result;
 }
 
+fd::Result fd::drawExpressionFile(const std::string& inputFileName, const std::string& outputFileName, const Options& options) {
+    auto inputFile = QFile(QString::fromStdString(inputFileName));
+    if (!inputFile.open(QIODevice::ReadOnly)) {
+        auto fileResult = fd::Result();
+        fileResult.errorMessage = "Cannot open " + inputFileName;
+        return fileResult;
+    }
+    auto data = inputFile.map(0, inputFile.size());
+    if (!data) {
+        auto bytes = inputFile.readAll();
+        return drawExpression(std::string_view(bytes.constData(), bytes.size()), outputFileName, options);
+    }
+    auto fileResult = drawExpression(std::string_view(reinterpret_cast<const char*>(data), inputFile.size()), outputFileName, options);
+    inputFile.unmap(data);
+    return fileResult;
+}
+
+static void addSheetError(fd::SheetResult& sheetResult, const std::string& message) {
+    if (!sheetResult.errorMessage.empty()) {
+        sheetResult.errorMessage += "\n";
+    }
+    sheetResult.errorMessage += message;
+}
+
+fd::SheetResult fd::drawSheet(const std::vector<std::string>& inputExpressions, const std::string& outputFileName, const Options& options) {
+    fd::v::setThreadsCount(options.threads);
+
+    auto sheetResult = SheetResult();
+    auto views = std::vector<std::unique_ptr<fd::v::View>>();
+    auto viewPages = std::vector<int>();
+    auto pageSizes = std::vector<QSize>();
+
+    int shelfX = 0, shelfY = 0, shelfHeight = 0;
+    for (const auto& inputExpression : inputExpressions) {
+        auto view = parseView(inputExpression, options);
+        sheetResult.results.push_back(result);
+        if (!view) {
+            views.push_back(nullptr);
+            viewPages.push_back(-1);
+            continue;
+        }
+
+        auto w = result.width;
+        auto h = result.height;
+        if (w > options.pageWidth || h > options.pageHeight) {
+            auto& formulaResult = sheetResult.results.back();
+            formulaResult.accepted = false;
+            formulaResult.errorMessage = "Formula of " + std::to_string(w) + "x" + std::to_string(h) + " does not fit into a page of "
+                + std::to_string(options.pageWidth) + "x" + std::to_string(options.pageHeight);
+            views.push_back(nullptr);
+            viewPages.push_back(-1);
+            continue;
+        }
+        if (shelfX > 0 && shelfX + w > options.pageWidth) {
+            shelfX = 0;
+            shelfY += shelfHeight + sheetSpacing;
+            shelfHeight = 0;
+        }
+        if (pageSizes.empty() || (shelfY > 0 && shelfY + h > options.pageHeight)) {
+            pageSizes.emplace_back(0, 0);
+            shelfX = 0;
+            shelfY = 0;
+            shelfHeight = 0;
+        }
+
+        view->x = shelfX;
+        view->y = shelfY;
+        pageSizes.back() = pageSizes.back().expandedTo(QSize(shelfX + w, shelfY + h));
+        shelfX += w + sheetSpacing;
+        shelfHeight = std::max(shelfHeight, h);
+
+        views.push_back(std::move(view));
+        viewPages.push_back(static_cast<int>(pageSizes.size()) - 1);
+    }
+
+    auto sheetFileNames = std::vector<std::string>();
+    auto palettes = std::vector<QVector<QRgb>>();
+    if (options.themes.empty()) {
+        sheetFileNames.push_back(outputFileName);
+        palettes.push_back(getGrayPalette());
+    }
+    for (const auto& theme : options.themes) {
+        sheetFileNames.push_back(siblingFileName(outputFileName, "-" + theme.name));
+        palettes.push_back(createPalette(theme.foreground, theme.background));
+    }
+
+    auto target = options.themes.empty() ? options.renderTarget : fd::RenderTarget::COVERAGE;
+    auto painter = QPainter();
+    auto writer = QImageWriter();
+    writer.setFormat("png");
+    writer.setQuality(100);
+    auto pages = std::vector<QJsonArray>(sheetFileNames.size());
+    for (int page = 0; page < pageSizes.size(); page++) {
+        auto pooledImage = createImage(pageSizes[page].width(), pageSizes[page].height(), target);
+        auto& image = pooledImage.image;
+        auto rasterizer = fd::rast::StrokeRasterizer(image.bits(), image.width(), image.height(), image.bytesPerLine());
+        auto isNative = options.nativeStrokes && target == fd::RenderTarget::COVERAGE;
+        auto rasterizerScope = fd::rast::RasterizerScope(isNative ? &rasterizer : nullptr);
+        painter.begin(&image);
+        setUpPainter(painter);
+        for (int i = 0; i < views.size(); i++) {
+            if (viewPages[i] == page) {
+                views[i]->draw(painter);
+            }
+        }
+        painter.end();
+
+        for (size_t sheet = 0; sheet < sheetFileNames.size(); sheet++) {
+            const auto& sheetFileName = sheetFileNames[sheet];
+            auto pageFileName = page == 0 ? sheetFileName : siblingFileName(sheetFileName, "-" + std::to_string(page));
+            writer.setFileName(QString::fromStdString(pageFileName));
+            if (!writeImage(writer, pooledImage.image, palettes[sheet])) {
+                addSheetError(sheetResult, "Cannot write " + pageFileName);
+            }
+            sheetResult.pageFileNames.push_back(pageFileName);
+            pages[sheet].append(QFileInfo(QString::fromStdString(pageFileName)).fileName());
+        }
+    }
+
+    auto formulas = QJsonArray();
+    for (int i = 0; i < views.size(); i++) {
+        auto formula = views[i] ? toJson(sheetResult.results[i]) : QJsonObject();
+        formula["index"] = i;
+        if (views[i]) {
+            formula["page"] = viewPages[i];
+            formula["x"] = views[i]->x;
+            formula["y"] = views[i]->y;
+        } else {
+            formula["error"] = QString::fromStdString(sheetResult.results[i].errorMessage);
+        }
+        formulas.append(formula);
+    }
+
+    for (size_t sheet = 0; sheet < sheetFileNames.size(); sheet++) {
+        auto indexFileName = siblingFileName(sheetFileNames[sheet], "", "json");
+        if (!saveJson(indexFileName, QJsonObject{{"pages", pages[sheet]}, {"formulas", formulas}})) {
+            addSheetError(sheetResult, "Cannot write " + indexFileName);
+        }
+        sheetResult.indexFileNames.push_back(indexFileName);
+    }
+
+    return sheetResult;
+}
+
+namespace {
+    struct LaidOutJob {
+        size_t index;
+        std::unique_ptr<fd::v::View> view;
+    };
+    struct DrawnJob {
+        size_t index;
+        fd::img::PooledImage image;
+    };
+    struct EncodedFile {
+        size_t index;
+        std::string fileName;
+        QByteArray bytes;
+    };
+}
+
+static QByteArray encodeImage(QImage& image, const QVector<QRgb>& palette = getGrayPalette()) {
+    auto bytes = QByteArray();
+    auto buffer = QBuffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    auto writer = QImageWriter(&buffer, "png");
+    writer.setQuality(100);
+    writeImage(writer, image, palette);
+    return bytes;
+}
+
+std::vector<fd::Result> fd::drawBatch(const std::vector<BatchJob>& jobs, const Options& options) {
+    fd::v::setThreadsCount(options.threads);
+
+    auto results = std::vector<Result>(jobs.size());
+    auto target = options.themes.empty() ? options.renderTarget : fd::RenderTarget::COVERAGE;
+    auto laidOutJobs = fd::pipe::BoundedQueue<LaidOutJob>(pipelineQueueCapacity);
+    auto drawnJobs = fd::pipe::BoundedQueue<DrawnJob>(pipelineQueueCapacity);
+    auto encodedFiles = fd::pipe::BoundedQueue<EncodedFile>(pipelineQueueCapacity);
+
+    auto drawingThread = std::thread([&] {
+        while (auto job = laidOutJobs.pop()) {
+            auto size = getImageSize(*job->view);
+            auto pooledImage = createImage(size.width(), size.height(), target);
+            drawView(*job->view, pooledImage.image, options.threads, options.nativeStrokes && target == fd::RenderTarget::COVERAGE);
+            job->view.reset();
+            drawnJobs.push({job->index, std::move(pooledImage)});
+        }
+        drawnJobs.close();
+    });
+
+    auto encodingThread = std::thread([&] {
+        while (auto job = drawnJobs.pop()) {
+            const auto& outputFileName = jobs[job->index].outputFileName;
+            if (options.themes.empty()) {
+                encodedFiles.push({job->index, outputFileName, encodeImage(job->image.image)});
+            }
+            for (const auto& theme : options.themes) {
+                auto palette = createPalette(theme.foreground, theme.background);
+                encodedFiles.push({job->index, siblingFileName(outputFileName, "-" + theme.name), encodeImage(job->image.image, palette)});
+            }
+        }
+        encodedFiles.close();
+    });
+
+    auto isFlushed = true;
+    auto writingThread = std::thread([&] {
+        auto writer = fd::out::OutputWriter(options.archiveFileName, options.syncBatchSize);
+        while (auto file = encodedFiles.pop()) {
+            if (!writer.write(file->fileName, file->bytes)) {
+                auto& jobResult = results[file->index];
+                jobResult.accepted = false;
+                jobResult.errorMessage = "Cannot write " + file->fileName;
+            }
+        }
+        isFlushed = writer.finish();
+    });
+
+    // The parser keeps its state in globals, so parsing stays on the calling thread
+    for (size_t i = 0; i < jobs.size(); i++) {
+        auto view = parseView(jobs[i].inputExpression, options);
+        results[i] = result;
+        if (view) {
+            laidOutJobs.push({i, std::move(view)});
+        }
+    }
+    laidOutJobs.close();
+
+    drawingThread.join();
+    encodingThread.join();
+    writingThread.join();
+
+    // A failed sync may lose any file written before it, so none of them can be trusted
+    if (!isFlushed) {
+        for (auto& jobResult : results) {
+            if (jobResult.accepted) {
+                jobResult.accepted = false;
+                jobResult.errorMessage = "Cannot flush the output to the disk";
+            }
+        }
+    }
+    return results;
+}
+
 void yy_accept_ast(std::unique_ptr<fd::exp::Expression> expression) {
-    result.accepted = true;
+    acceptedExpression = std::move(expression);
+}
 
-    auto view = expression->createView();
-    view->measure();
-    view->layout();
+static void addDiagnostic(int line, int column, const char* format, va_list arguments) {
+    va_list argumentsCopy;
+    va_copy(argumentsCopy, arguments);
+    char* result_chars = new char[vsnprintf(nullptr, 0, format, argumentsCopy) + 1];
+    va_end(argumentsCopy);
 
-    auto image = QImage(view->w, view->h, QImage::Format_RGB32);
-    image.fill(QColor(255, 255, 255));
-    auto painter = QPainter(&image);
-    auto pen = QPen(QColor(0, 0, 0));
-    pen.setWidthF(4);
-    painter.setPen(pen);
-    painter.setRenderHint(QPainter::Antialiasing);
-    view->draw(painter);
-    image.save(fileName.c_str(), "PNG", 100);
+    vsprintf(result_chars, format, arguments);
+
+    result.diagnostics.push_back({line, column, result_chars});
+    delete[] result_chars;
+
+    if (!result.errorMessage.empty()) {
+        result.errorMessage += "\n";
+    }
+    result.errorMessage += std::to_string(line) + ":" + std::to_string(column) + ": " + result.diagnostics.back().message;
 }
 
 void yyerror(const char* format, ...) {
-    result.accepted = false;
-
     va_list arguments;
-
     va_start(arguments, format);
-    char* result_chars = new char[vsnprintf(nullptr, 0, format, arguments) + 1];
+    addDiagnostic(yylloc.first_line, yylloc.first_column, format, arguments);
     va_end(arguments);
+}
 
+void yyerror_at(int line, int column, const char* format, ...) {
+    va_list arguments;
     va_start(arguments, format);
-    vsprintf(result_chars, format, arguments);
+    addDiagnostic(line, column, format, arguments);
     va_end(arguments);
-
-    result.errorMessage = result_chars;
-    delete[] result_chars;
 }
@@ -1,11 +1,60 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace fd {
+    enum class RenderTarget {
+        RGB32,
+        COVERAGE
+    };
+    struct Theme {
+        std::string name;
+        unsigned foreground = 0x000000;
+        unsigned background = 0xffffff;
+    };
+    struct Options {
+        unsigned threads = 1;
+        RenderTarget renderTarget = RenderTarget::RGB32;
+        bool nativeStrokes = false;
+        std::vector<Theme> themes;
+        int pageWidth = 4096;
+        int pageHeight = 4096;
+        bool tokenBoxes = false;
+        std::string metricsFileName;
+        std::string archiveFileName;
+        unsigned syncBatchSize = 0;
+    };
+    struct Diagnostic {
+        int line = 0, column = 0;
+        std::string message;
+    };
+    struct Box {
+        double x = 0, y = 0, width = 0, height = 0, cy = 0;
+    };
     struct Result {
         bool accepted = false;
         std::string errorMessage;
+        std::vector<Diagnostic> diagnostics;
+        int width = 0, height = 0;
+        double cy = 0;
+        std::vector<Box> boxes;
+    };
+    struct SheetResult {
+        std::vector<Result> results;
+        std::vector<std::string> pageFileNames;
+        std::vector<std::string> indexFileNames;
+        std::string errorMessage;
+    };
+    struct BatchJob {
+        std::string inputExpression;
+        std::string outputFileName;
     };
-    Result drawExpression(const std::string& inputExpression, const std::string& outputFileName);
+    // The snapshot is shared by the whole process, so it can only be chosen before the first formula is measured
+    bool setFontSnapshotFileName(const std::string& fileName);
+    Result drawExpression(std::string_view inputExpression, const std::string& outputFileName, const Options& options = {});
+    Result drawExpressionFile(const std::string& inputFileName, const std::string& outputFileName, const Options& options = {});
+    SheetResult drawSheet(const std::vector<std::string>& inputExpressions, const std::string& outputFileName, const Options& options = {});
+    std::vector<Result> drawBatch(const std::vector<BatchJob>& jobs, const Options& options = {});
 }
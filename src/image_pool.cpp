@@ -0,0 +1,52 @@
+#include "image_pool.h"
+
+static constexpr size_t minCapacity = 64 * 1024;
+static constexpr size_t maxBucketSize = 4;
+
+// QImage requires scan lines of external buffers aligned to 32 bits
+static int getBytesPerLine(int width, QImage::Format format) {
+    return (width * QImage::toPixelFormat(format).bitsPerPixel() / 8 + 3) / 4 * 4;
+}
+
+fd::img::PooledImage::PooledImage(ImagePool* pool, size_t capacity, std::unique_ptr<uchar[]> buffer, int width, int height, QImage::Format format):
+    pool(pool), capacity(capacity), buffer(std::move(buffer)) {
+    image = QImage(this->buffer.get(), width, height, getBytesPerLine(width, format), format);
+}
+
+fd::img::PooledImage::~PooledImage() {
+    image = QImage();
+    if (buffer) {
+        pool->release(capacity, std::move(buffer));
+    }
+}
+
+fd::img::PooledImage fd::img::ImagePool::acquire(int width, int height, QImage::Format format) {
+    auto size = static_cast<size_t>(getBytesPerLine(width, format)) * height;
+    auto capacity = minCapacity;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+
+    std::unique_ptr<uchar[]> buffer;
+    {
+        auto lock = std::lock_guard(mutex);
+        auto& bucket = buffers[capacity];
+        if (!bucket.empty()) {
+            buffer = std::move(bucket.back());
+            bucket.pop_back();
+        }
+    }
+    if (!buffer) {
+        buffer = std::unique_ptr<uchar[]>(new uchar[capacity]);
+    }
+
+    return PooledImage(this, capacity, std::move(buffer), width, height, format);
+}
+
+void fd::img::ImagePool::release(size_t capacity, std::unique_ptr<uchar[]> buffer) {
+    auto lock = std::lock_guard(mutex);
+    auto& bucket = buffers[capacity];
+    if (bucket.size() < maxBucketSize) {
+        bucket.push_back(std::move(buffer));
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <QImage>
+
+namespace fd::img {
+    class ImagePool;
+
+    class PooledImage {
+    public:
+        QImage image;
+
+        PooledImage(ImagePool* pool, size_t capacity, std::unique_ptr<uchar[]> buffer, int width, int height, QImage::Format format);
+        PooledImage(PooledImage&& other) = default;
+        PooledImage& operator=(PooledImage&& other) = delete;
+
+        ~PooledImage();
+
+    private:
+        ImagePool* pool;
+        size_t capacity;
+        std::unique_ptr<uchar[]> buffer;
+    };
+
+    class ImagePool {
+    public:
+        PooledImage acquire(int width, int height, QImage::Format format);
+
+    private:
+        friend class PooledImage;
+
+        std::mutex mutex;
+        std::unordered_map<size_t, std::vector<std::unique_ptr<uchar[]>>> buffers;
+
+        void release(size_t capacity, std::unique_ptr<uchar[]> buffer);
+    };
+}
@@ -0,0 +1,146 @@
+#include "output_writer.h"
+#include <cstring>
+#include <ctime>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+static constexpr int tarBlockSize = 512;
+
+static bool flushToDisk(QFile& file) {
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_UNIX
+    return ::fsync(file.handle()) == 0;
+#else
+    return true;
+#endif
+}
+
+static void writeOctal(char* field, size_t fieldSize, unsigned long long value) {
+    for (auto i = static_cast<ptrdiff_t>(fieldSize) - 2; i >= 0; i--) {
+        field[i] = static_cast<char>('0' + (value & 7));
+        value >>= 3;
+    }
+    field[fieldSize - 1] = '\0';
+}
+
+fd::out::OutputWriter::OutputWriter(const std::string& archiveFileName, unsigned syncBatchSize):
+    syncBatchSize(syncBatchSize) {
+    if (!archiveFileName.empty()) {
+        archive = std::make_unique<QFile>(QString::fromStdString(archiveFileName));
+        archive->open(QIODevice::WriteOnly);
+    }
+}
+
+fd::out::OutputWriter::~OutputWriter() {
+    finish();
+}
+
+bool fd::out::OutputWriter::write(const std::string& fileName, const QByteArray& bytes) {
+    if (archive) {
+        if (!writeArchiveEntry(fileName, bytes)) {
+            return false;
+        }
+    } else {
+        auto file = QFile(QString::fromStdString(fileName));
+        if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size()) {
+            return false;
+        }
+        file.close();
+        if (file.error() != QFileDevice::NoError) {
+            return false;
+        }
+        // Files are closed right away and reopened to be synced, large batches would run out of descriptors otherwise
+        if (syncBatchSize > 0) {
+            unsyncedFileNames.push_back(file.fileName());
+        }
+    }
+
+    unsyncedEntriesCount++;
+    if (syncBatchSize > 0 && unsyncedEntriesCount >= syncBatchSize && !sync()) {
+        isFlushed = false;
+    }
+    return true;
+}
+
+bool fd::out::OutputWriter::finish() {
+    if (isFinished) {
+        return isFlushed;
+    }
+    isFinished = true;
+
+    if (archive && archive->isOpen() && archive->write(QByteArray(2 * tarBlockSize, '\0')) != 2 * tarBlockSize) {
+        isFlushed = false;
+    }
+    if (syncBatchSize > 0 && !sync()) {
+        isFlushed = false;
+    }
+    if (archive) {
+        archive->close();
+        if (archive->error() != QFileDevice::NoError) {
+            isFlushed = false;
+        }
+    }
+    return isFlushed;
+}
+
+bool fd::out::OutputWriter::writeArchiveEntry(const std::string& fileName, const QByteArray& bytes) {
+    if (!archive->isOpen()) {
+        return false;
+    }
+
+    char header[tarBlockSize] = {};
+    auto name = fileName;
+    auto prefix = std::string();
+    if (name.size() > 100) {
+        auto separator = name.find('/', name.size() - 101);
+        if (separator == std::string::npos || separator > 155) {
+            return false;
+        }
+        prefix = name.substr(0, separator);
+        name = name.substr(separator + 1);
+    }
+
+    std::memcpy(header, name.data(), name.size());
+    writeOctal(header + 100, 8, 0644);
+    writeOctal(header + 108, 8, 0);
+    writeOctal(header + 116, 8, 0);
+    writeOctal(header + 124, 12, bytes.size());
+    writeOctal(header + 136, 12, std::time(nullptr));
+    header[156] = '0';
+    std::memcpy(header + 257, "ustar", 6);
+    std::memcpy(header + 263, "00", 2);
+    std::memcpy(header + 345, prefix.data(), prefix.size());
+
+    // The checksum is computed with its own field filled with spaces
+    std::memset(header + 148, ' ', 8);
+    unsigned checksum = 0;
+    for (auto byte : header) {
+        checksum += static_cast<unsigned char>(byte);
+    }
+    writeOctal(header + 148, 7, checksum);
+
+    auto padding = (tarBlockSize - bytes.size() % tarBlockSize) % tarBlockSize;
+    return archive->write(header, tarBlockSize) == tarBlockSize
+        && archive->write(bytes) == bytes.size()
+        && archive->write(QByteArray(padding, '\0')) == padding;
+}
+
+bool fd::out::OutputWriter::sync() {
+    auto isSynced = true;
+    if (archive && archive->isOpen()) {
+        isSynced = flushToDisk(*archive);
+    }
+    for (const auto& fileName : unsyncedFileNames) {
+        auto file = QFile(fileName);
+        if (!file.open(QIODevice::ReadOnly) || !flushToDisk(file)) {
+            isSynced = false;
+        }
+    }
+    unsyncedFileNames.clear();
+    unsyncedEntriesCount = 0;
+    return isSynced;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+namespace fd::out {
+    class OutputWriter {
+    public:
+        OutputWriter(const std::string& archiveFileName, unsigned syncBatchSize);
+        OutputWriter(const OutputWriter&) = delete;
+        OutputWriter& operator=(const OutputWriter&) = delete;
+
+        ~OutputWriter();
+
+        bool write(const std::string& fileName, const QByteArray& bytes);
+
+        bool finish();
+
+    private:
+        std::unique_ptr<QFile> archive;
+        std::vector<QString> unsyncedFileNames;
+        unsigned syncBatchSize;
+        unsigned unsyncedEntriesCount = 0;
+        bool isFinished = false;
+        bool isFlushed = true;
+
+        bool writeArchiveEntry(const std::string& fileName, const QByteArray& bytes);
+        bool sync();
+    };
+}
@@ -1,4 +1,6 @@
 %expect 0
+%locations
+%define parse.error verbose
 %code requires {
 #include <string>
 #include <expression.h>
@@ -6,6 +8,7 @@
 
 extern int yylex(void);
 extern void yyerror(const char *s, ...);
+extern void yyerror_at(int line, int column, const char *s, ...);
 extern void yy_accept_ast(std::unique_ptr<fd::exp::Expression> expression);
 }
 
@@ -16,17 +19,19 @@ extern void yy_accept_ast(std::unique_ptr<fd::exp::Expression> expression);
     std::vector<std::unique_ptr<fd::exp::Expression>>* matrixRow;
 }
 
-%token END_OF_FILE
+%token END_OF_FILE "end of input"
 %token <expression> PRIMITIVE
 
 %token EQUAL_OPERATOR UNEQUAL_OPERATOR LESS_OPERATOR GREATER_OPERATOR LESS_EQUAL_OPERATOR GREATER_EQUAL_OPERATOR
 %token SUM PRODUCT INTEGRAL CASES MATRIX
 
-%type <expression> exp
+%type <expression> exp top-level
 %type <cases> cases
 %type <matrix> matrix
 %type <matrixRow> matrix-row
 
+%destructor { delete $$; } <expression> <cases> <matrix> <matrixRow>
+
 %left EQUAL_OPERATOR UNEQUAL_OPERATOR LESS_OPERATOR GREATER_OPERATOR LESS_EQUAL_OPERATOR GREATER_EQUAL_OPERATOR
 %left '+' '-'
 %left '*' '/'
@@ -37,30 +42,43 @@ extern void yy_accept_ast(std::unique_ptr<fd::exp::Expression> expression);
 %%
 
 input:
-    exp END_OF_FILE  { yy_accept_ast(ph::uniquePtr($1)); YYACCEPT; }
+    top-level END_OF_FILE  { yy_accept_ast(ph::uniquePtr($1)); YYACCEPT; }
+|   error END_OF_FILE      { YYABORT; }
+
+top-level:
+    exp                    { $$ = $1; }
+|   top-level error exp    { $$ = $1; delete $3; yyerrok; }
+|   error exp              { $$ = $2; yyerrok; }
 
 exp:
     PRIMITIVE                       { $$ = $1; }
 |   '(' exp ')'                     { $$ = new fd::exp::Bracketed(ph::uniquePtr($2)); }
 |   exp '[' exp ']'                 { $$ = new fd::exp::Index(ph::uniquePtr($1), ph::uniquePtr($3)); }
 |   exp '^' exp                     { $$ = new fd::exp::Power(ph::uniquePtr($1), ph::uniquePtr($3)); }
-|   '+' exp %prec UNARY_PLUS        { $$ = new fd::exp::Unary(u8"+", ph::uniquePtr($2)); }
-|   '-' exp %prec UNARY_MINUS       { $$ = new fd::exp::Unary(u8"−", ph::uniquePtr($2)); }
-|   exp '*' exp                     { $$ = new fd::exp::Binary(u8"⋅", ph::uniquePtr($1), ph::uniquePtr($3)); }
+|   '+' exp %prec UNARY_PLUS        { $$ = new fd::exp::Unary(fd::sym::Symbol::PLUS, ph::uniquePtr($2)); }
+|   '-' exp %prec UNARY_MINUS       { $$ = new fd::exp::Unary(fd::sym::Symbol::MINUS, ph::uniquePtr($2)); }
+|   exp '*' exp                     { $$ = new fd::exp::Binary(fd::sym::Symbol::DOT, ph::uniquePtr($1), ph::uniquePtr($3)); }
 |   exp '/' exp                     { $$ = new fd::exp::Division(ph::uniquePtr($1), ph::uniquePtr($3)); }
-|   exp '+' exp                     { $$ = new fd::exp::Binary(u8"+", ph::uniquePtr($1), ph::uniquePtr($3)); }
-|   exp '-' exp                     { $$ = new fd::exp::Binary(u8"−", ph::uniquePtr($1), ph::uniquePtr($3)); }
-|   exp EQUAL_OPERATOR exp          { $$ = new fd::exp::Binary(u8"=", ph::uniquePtr($1), ph::uniquePtr($3)); }
-|   exp UNEQUAL_OPERATOR exp        { $$ = new fd::exp::Binary(u8"≠", ph::uniquePtr($1), ph::uniquePtr($3)); }
-|   exp LESS_OPERATOR exp           { $$ = new fd::exp::Binary(u8"<", ph::uniquePtr($1), ph::uniquePtr($3)); }
-|   exp GREATER_OPERATOR exp        { $$ = new fd::exp::Binary(u8">", ph::uniquePtr($1), ph::uniquePtr($3)); }
-|   exp LESS_EQUAL_OPERATOR exp     { $$ = new fd::exp::Binary(u8"≤", ph::uniquePtr($1), ph::uniquePtr($3)); }
-|   exp GREATER_EQUAL_OPERATOR exp  { $$ = new fd::exp::Binary(u8"≥", ph::uniquePtr($1), ph::uniquePtr($3)); }
-|   SUM      '(' exp ',' exp ',' exp ')'  { $$ = new fd::exp::Variadic(u8"∑", ph::uniquePtr($3), ph::uniquePtr($5), ph::uniquePtr($7)); }
-|   PRODUCT  '(' exp ',' exp ',' exp ')'  { $$ = new fd::exp::Variadic(u8"∏", ph::uniquePtr($3), ph::uniquePtr($5), ph::uniquePtr($7)); }
-|   INTEGRAL '(' exp ',' exp ',' exp ')'  { $$ = new fd::exp::Variadic(u8"∫", ph::uniquePtr($3), ph::uniquePtr($5), ph::uniquePtr($7)); }
+|   exp '+' exp                     { $$ = new fd::exp::Binary(fd::sym::Symbol::PLUS, ph::uniquePtr($1), ph::uniquePtr($3)); }
+|   exp '-' exp                     { $$ = new fd::exp::Binary(fd::sym::Symbol::MINUS, ph::uniquePtr($1), ph::uniquePtr($3)); }
+|   exp EQUAL_OPERATOR exp          { $$ = new fd::exp::Binary(fd::sym::Symbol::EQUAL, ph::uniquePtr($1), ph::uniquePtr($3)); }
+|   exp UNEQUAL_OPERATOR exp        { $$ = new fd::exp::Binary(fd::sym::Symbol::UNEQUAL, ph::uniquePtr($1), ph::uniquePtr($3)); }
+|   exp LESS_OPERATOR exp           { $$ = new fd::exp::Binary(fd::sym::Symbol::LESS, ph::uniquePtr($1), ph::uniquePtr($3)); }
+|   exp GREATER_OPERATOR exp        { $$ = new fd::exp::Binary(fd::sym::Symbol::GREATER, ph::uniquePtr($1), ph::uniquePtr($3)); }
+|   exp LESS_EQUAL_OPERATOR exp     { $$ = new fd::exp::Binary(fd::sym::Symbol::LESS_EQUAL, ph::uniquePtr($1), ph::uniquePtr($3)); }
+|   exp GREATER_EQUAL_OPERATOR exp  { $$ = new fd::exp::Binary(fd::sym::Symbol::GREATER_EQUAL, ph::uniquePtr($1), ph::uniquePtr($3)); }
+|   SUM      '(' exp ',' exp ',' exp ')'  { $$ = new fd::exp::Variadic(fd::sym::Symbol::SUM, ph::uniquePtr($3), ph::uniquePtr($5), ph::uniquePtr($7)); }
+|   PRODUCT  '(' exp ',' exp ',' exp ')'  { $$ = new fd::exp::Variadic(fd::sym::Symbol::PRODUCT, ph::uniquePtr($3), ph::uniquePtr($5), ph::uniquePtr($7)); }
+|   INTEGRAL '(' exp ',' exp ',' exp ')'  { $$ = new fd::exp::Variadic(fd::sym::Symbol::INTEGRAL, ph::uniquePtr($3), ph::uniquePtr($5), ph::uniquePtr($7)); }
 |   CASES '(' cases ')'                   { $$ = new fd::exp::Cases(ph::unwrap($3)); }
-|   MATRIX '(' matrix ')'                 { $$ = new fd::exp::Matrix(ph::unwrap($3)); }
+|   MATRIX '(' matrix ')'                 { $$ = ph::checkedMatrix(ph::unwrap($3), @1.first_line, @1.first_column); }
+|   '(' error ')'                         { $$ = ph::errorPlaceholder(); }
+|   exp '[' error ']'                     { $$ = new fd::exp::Index(ph::uniquePtr($1), ph::uniquePtr(ph::errorPlaceholder())); }
+|   SUM      '(' error ')'                { $$ = ph::errorPlaceholder(); }
+|   PRODUCT  '(' error ')'                { $$ = ph::errorPlaceholder(); }
+|   INTEGRAL '(' error ')'                { $$ = ph::errorPlaceholder(); }
+|   CASES    '(' error ')'                { $$ = ph::errorPlaceholder(); }
+|   MATRIX   '(' error ')'                { $$ = ph::errorPlaceholder(); }
 
 cases:
     exp ',' exp            { $$ = new std::vector<fd::exp::Case>(); $$->emplace_back(ph::uniquePtr($1), ph::uniquePtr($3)); }
@@ -69,6 +87,8 @@ cases:
 matrix:
     '(' matrix-row ')'             { $$ = new std::vector<std::vector<std::unique_ptr<fd::exp::Expression>>>(); $$->push_back(ph::unwrap($2)); }
 |   matrix ',' '(' matrix-row ')'  { $$ = $1; $$->push_back(ph::unwrap($4)); }
+|   '(' error ')'                  { $$ = new std::vector<std::vector<std::unique_ptr<fd::exp::Expression>>>(); }
+|   matrix ',' '(' error ')'       { $$ = $1; }
 
 matrix-row:
     exp                 { $$ = new std::vector<std::unique_ptr<fd::exp::Expression>>(); $$->emplace_back($1); }
@@ -1,5 +1,21 @@
 #include "parser_helper.h"
+#include <stdexcept>
+#include <parser.h>
 
 std::unique_ptr<fd::exp::Expression> ph::uniquePtr(fd::exp::Expression* expression) {
     return std::unique_ptr<fd::exp::Expression>(expression);;
 }
+
+fd::exp::Expression* ph::errorPlaceholder() {
+    return new fd::exp::Primitive("?");
+}
+
+fd::exp::Expression* ph::checkedMatrix(std::vector<std::vector<std::unique_ptr<fd::exp::Expression>>> matrix, int line, int column) {
+    auto result = new fd::exp::Matrix(std::move(matrix));
+    try {
+        result->checkCorrectness();
+    } catch (const std::invalid_argument& exception) {
+        yyerror_at(line, column, "%s", exception.what());
+    }
+    return result;
+}
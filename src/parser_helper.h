@@ -13,4 +13,8 @@ namespace ph {
     }
 
     std::unique_ptr<fd::exp::Expression> uniquePtr(fd::exp::Expression* expression);
+
+    fd::exp::Expression* errorPlaceholder();
+
+    fd::exp::Expression* checkedMatrix(std::vector<std::vector<std::unique_ptr<fd::exp::Expression>>> matrix, int line, int column);
 }
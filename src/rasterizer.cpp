@@ -0,0 +1,268 @@
+#include "rasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define FD_RASTERIZER_AVX2 1
+#endif
+
+namespace {
+    struct Segment {
+        float ax, ay, bx, by;
+        float ux, uy;
+        float startOffset, endOffset;
+        float edge;
+        float startBevelX, startBevelY, startBevel;
+        float endBevelX, endBevelY, endBevel;
+    };
+}
+
+// QPainterPath flattens curves to half a pixel, which shows on the edges of thick strokes
+static constexpr qreal flatteningScale = 4;
+
+static inline float clamp01(float value) {
+    return std::min(std::max(value, 0.f), 1.f);
+}
+
+static inline float getCoverage(const Segment& segment, float px, float py) {
+    auto dx = px - segment.ax, dy = py - segment.ay;
+    auto ex = px - segment.bx, ey = py - segment.by;
+    auto t = dx * segment.ux + dy * segment.uy;
+    auto v = std::abs(dx * segment.uy - dy * segment.ux);
+    auto box = clamp01(segment.edge - v) * (clamp01(t + segment.startOffset) * clamp01(segment.endOffset - t));
+    auto startBevel = clamp01(segment.startBevel - (dx * segment.startBevelX + dy * segment.startBevelY));
+    auto endBevel = clamp01(segment.endBevel - (ex * segment.endBevelX + ey * segment.endBevelY));
+    return std::min(box, std::min(startBevel, endBevel));
+}
+
+// Segments of one path overlap at the joints, so coverage is combined with max instead of being added up
+static inline void coverPixel(uchar& pixel, float coverage) {
+    pixel = std::max(pixel, static_cast<uchar>(coverage * 255 + 0.5f));
+}
+
+static void coverRowScalar(const Segment& segment, uchar* row, int x0, int x1, float py) {
+    for (int x = x0; x < x1; x++) {
+        coverPixel(row[x], getCoverage(segment, x + 0.5f, py));
+    }
+}
+
+#if defined(__SSE2__)
+static inline __m128 clamp01Sse2(__m128 value) {
+    return _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1));
+}
+
+static void coverRowSse2(const Segment& segment, uchar* row, int x0, int x1, float py) {
+    const auto signMask = _mm_set1_ps(-0.f);
+    const auto ux = _mm_set1_ps(segment.ux), uy = _mm_set1_ps(segment.uy);
+    const auto dy = _mm_set1_ps(py - segment.ay), ey = _mm_set1_ps(py - segment.by);
+    const auto dyUx = _mm_mul_ps(dy, ux), dyUy = _mm_mul_ps(dy, uy);
+    const auto dyStartBevel = _mm_mul_ps(dy, _mm_set1_ps(segment.startBevelY)), eyEndBevel = _mm_mul_ps(ey, _mm_set1_ps(segment.endBevelY));
+    const auto startBevelX = _mm_set1_ps(segment.startBevelX), endBevelX = _mm_set1_ps(segment.endBevelX);
+    const auto edge = _mm_set1_ps(segment.edge);
+    const auto startOffset = _mm_set1_ps(segment.startOffset), endOffset = _mm_set1_ps(segment.endOffset);
+    const auto startBevel = _mm_set1_ps(segment.startBevel), endBevel = _mm_set1_ps(segment.endBevel);
+    const auto centers = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+    auto x = x0;
+    for (; x + 4 <= x1; x += 4) {
+        auto px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), centers);
+        auto dx = _mm_sub_ps(px, _mm_set1_ps(segment.ax));
+        auto ex = _mm_sub_ps(px, _mm_set1_ps(segment.bx));
+        auto t = _mm_add_ps(_mm_mul_ps(dx, ux), dyUy);
+        auto v = _mm_andnot_ps(signMask, _mm_sub_ps(_mm_mul_ps(dx, uy), dyUx));
+        auto box = _mm_mul_ps(
+            clamp01Sse2(_mm_sub_ps(edge, v)),
+            _mm_mul_ps(clamp01Sse2(_mm_add_ps(t, startOffset)), clamp01Sse2(_mm_sub_ps(endOffset, t)))
+        );
+        auto startCut = clamp01Sse2(_mm_sub_ps(startBevel, _mm_add_ps(_mm_mul_ps(dx, startBevelX), dyStartBevel)));
+        auto endCut = clamp01Sse2(_mm_sub_ps(endBevel, _mm_add_ps(_mm_mul_ps(ex, endBevelX), eyEndBevel)));
+        auto coverage = _mm_min_ps(box, _mm_min_ps(startCut, endCut));
+
+        auto words = _mm_packs_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage, _mm_set1_ps(255)), _mm_set1_ps(0.5f))), _mm_setzero_si128());
+        auto bytes = _mm_packus_epi16(words, words);
+        int32_t pixels;
+        std::memcpy(&pixels, row + x, sizeof(pixels));
+        pixels = _mm_cvtsi128_si32(_mm_max_epu8(bytes, _mm_cvtsi32_si128(pixels)));
+        std::memcpy(row + x, &pixels, sizeof(pixels));
+    }
+    coverRowScalar(segment, row, x, x1, py);
+}
+#endif
+
+#if FD_RASTERIZER_AVX2
+__attribute__((target("avx2")))
+static inline __m256 clamp01Avx2(__m256 value) {
+    return _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1));
+}
+
+__attribute__((target("avx2")))
+static void coverRowAvx2(const Segment& segment, uchar* row, int x0, int x1, float py) {
+    const auto signMask = _mm256_set1_ps(-0.f);
+    const auto ux = _mm256_set1_ps(segment.ux), uy = _mm256_set1_ps(segment.uy);
+    const auto dy = _mm256_set1_ps(py - segment.ay), ey = _mm256_set1_ps(py - segment.by);
+    const auto dyUx = _mm256_mul_ps(dy, ux), dyUy = _mm256_mul_ps(dy, uy);
+    const auto dyStartBevel = _mm256_mul_ps(dy, _mm256_set1_ps(segment.startBevelY)), eyEndBevel = _mm256_mul_ps(ey, _mm256_set1_ps(segment.endBevelY));
+    const auto startBevelX = _mm256_set1_ps(segment.startBevelX), endBevelX = _mm256_set1_ps(segment.endBevelX);
+    const auto edge = _mm256_set1_ps(segment.edge);
+    const auto startOffset = _mm256_set1_ps(segment.startOffset), endOffset = _mm256_set1_ps(segment.endOffset);
+    const auto startBevel = _mm256_set1_ps(segment.startBevel), endBevel = _mm256_set1_ps(segment.endBevel);
+    const auto centers = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+
+    auto x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        auto px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), centers);
+        auto dx = _mm256_sub_ps(px, _mm256_set1_ps(segment.ax));
+        auto ex = _mm256_sub_ps(px, _mm256_set1_ps(segment.bx));
+        auto t = _mm256_add_ps(_mm256_mul_ps(dx, ux), dyUy);
+        auto v = _mm256_andnot_ps(signMask, _mm256_sub_ps(_mm256_mul_ps(dx, uy), dyUx));
+        auto box = _mm256_mul_ps(
+            clamp01Avx2(_mm256_sub_ps(edge, v)),
+            _mm256_mul_ps(clamp01Avx2(_mm256_add_ps(t, startOffset)), clamp01Avx2(_mm256_sub_ps(endOffset, t)))
+        );
+        auto startCut = clamp01Avx2(_mm256_sub_ps(startBevel, _mm256_add_ps(_mm256_mul_ps(dx, startBevelX), dyStartBevel)));
+        auto endCut = clamp01Avx2(_mm256_sub_ps(endBevel, _mm256_add_ps(_mm256_mul_ps(ex, endBevelX), eyEndBevel)));
+        auto coverage = _mm256_min_ps(box, _mm256_min_ps(startCut, endCut));
+
+        auto integers = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(coverage, _mm256_set1_ps(255)), _mm256_set1_ps(0.5f)));
+        auto words = _mm_packs_epi32(_mm256_castsi256_si128(integers), _mm256_extracti128_si256(integers, 1));
+        auto bytes = _mm_packus_epi16(words, words);
+        auto pixels = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + x));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(row + x), _mm_max_epu8(bytes, pixels));
+    }
+    coverRowScalar(segment, row, x, x1, py);
+}
+#endif
+
+using RowFunction = void (*)(const Segment&, uchar*, int, int, float);
+
+static RowFunction getRowFunction(fd::rast::Kernel kernel) {
+    switch (kernel) {
+#if FD_RASTERIZER_AVX2
+        case fd::rast::Kernel::AVX2:
+            return __builtin_cpu_supports("avx2") ? coverRowAvx2 : nullptr;
+#endif
+#if defined(__SSE2__)
+        case fd::rast::Kernel::SSE2:
+            return coverRowSse2;
+#endif
+        case fd::rast::Kernel::SCALAR:
+            return coverRowScalar;
+        default:
+            return nullptr;
+    }
+}
+
+static RowFunction selectRowFunction() {
+    for (auto kernel : {fd::rast::Kernel::AVX2, fd::rast::Kernel::SSE2}) {
+        if (auto rowFunction = getRowFunction(kernel)) {
+            return rowFunction;
+        }
+    }
+    return coverRowScalar;
+}
+
+static RowFunction coverRow = selectRowFunction();
+
+bool fd::rast::setKernel(Kernel kernel) {
+    auto rowFunction = getRowFunction(kernel);
+    if (rowFunction) {
+        coverRow = rowFunction;
+    }
+    return rowFunction != nullptr;
+}
+
+
+fd::rast::StrokeRasterizer::StrokeRasterizer(uchar* bits, int width, int height, int bytesPerLine):
+    bits(bits), width(width), height(height), bytesPerLine(bytesPerLine) { }
+
+void fd::rast::StrokeRasterizer::strokePath(const QPainterPath& path, const QTransform& transform, qreal penWidth) {
+    auto radius = static_cast<float>(penWidth * std::sqrt(std::abs(transform.determinant())) / 2);
+    auto flatteningTransform = transform * QTransform::fromScale(flatteningScale, flatteningScale);
+    for (auto polyline : path.toSubpathPolygons(flatteningTransform)) {
+        for (auto& point : polyline) {
+            point /= flatteningScale;
+        }
+        // Zero length segments have no direction to be joined along
+        auto isSamePoint = [](QPointF a, QPointF b) { return std::hypot(b.x() - a.x(), b.y() - a.y()) < 1e-4; };
+        polyline.erase(std::unique(polyline.begin(), polyline.end(), isSamePoint), polyline.end());
+        for (int i = 0; i + 1 < polyline.size(); i++) {
+            strokeSegment(polyline, i, radius);
+        }
+    }
+}
+
+// Qt joins segments with bevels, so a box runs on past the joint over the corner of the bevel and is cut along it
+static void setJoint(QPointF previous, QPointF joint, QPointF next, float radius, float& offset, float& bevelX, float& bevelY, float& bevel) {
+    auto incoming = joint - previous, outgoing = next - joint;
+    incoming /= std::hypot(incoming.x(), incoming.y());
+    outgoing /= std::hypot(outgoing.x(), outgoing.y());
+    auto cosine = QPointF::dotProduct(incoming, outgoing);
+    auto sine = std::abs(incoming.x() * outgoing.y() - incoming.y() * outgoing.x());
+    offset = static_cast<float>(radius * sine + 1);
+
+    auto normal = incoming - outgoing;
+    auto normalLength = std::hypot(normal.x(), normal.y());
+    if (normalLength > 1e-6) {
+        normal /= normalLength;
+    }
+    bevelX = static_cast<float>(normal.x());
+    bevelY = static_cast<float>(normal.y());
+    bevel = static_cast<float>(radius * std::sqrt(std::max(0.0, (1 + cosine) / 2)) + 0.5);
+}
+
+void fd::rast::StrokeRasterizer::strokeSegment(const QPolygonF& polyline, int index, float radius) {
+    auto a = polyline[index], b = polyline[index + 1];
+    auto length = static_cast<float>(std::hypot(b.x() - a.x(), b.y() - a.y()));
+
+    auto segment = Segment();
+    segment.ax = static_cast<float>(a.x());
+    segment.ay = static_cast<float>(a.y());
+    segment.bx = static_cast<float>(b.x());
+    segment.by = static_cast<float>(b.y());
+    segment.ux = (segment.bx - segment.ax) / length;
+    segment.uy = (segment.by - segment.ay) / length;
+    segment.edge = radius + 0.5f;
+    // Square caps, the bevels of the caps never cut anything
+    segment.startOffset = radius + 0.5f;
+    segment.endOffset = length + radius + 0.5f;
+    segment.startBevel = segment.endBevel = 1;
+    if (index > 0) {
+        setJoint(polyline[index - 1], a, b, radius, segment.startOffset, segment.startBevelX, segment.startBevelY, segment.startBevel);
+    }
+    if (index + 2 < polyline.size()) {
+        auto endOffset = 0.f;
+        setJoint(a, b, polyline[index + 2], radius, endOffset, segment.endBevelX, segment.endBevelY, segment.endBevel);
+        segment.endOffset = length + endOffset;
+    }
+
+    auto margin = radius + 1;
+    auto x0 = std::max(0, static_cast<int>(std::floor(std::min(segment.ax, segment.bx) - margin)));
+    auto x1 = std::min(width, static_cast<int>(std::ceil(std::max(segment.ax, segment.bx) + margin)));
+    auto y0 = std::max(0, static_cast<int>(std::floor(std::min(segment.ay, segment.by) - margin)));
+    auto y1 = std::min(height, static_cast<int>(std::ceil(std::max(segment.ay, segment.by) + margin)));
+    for (int y = y0; y < y1; y++) {
+        coverRow(segment, bits + static_cast<ptrdiff_t>(y) * bytesPerLine, x0, x1, y + 0.5f);
+    }
+}
+
+
+static thread_local fd::rast::StrokeRasterizer* threadRasterizer = nullptr;
+
+fd::rast::RasterizerScope::RasterizerScope(StrokeRasterizer* rasterizer):
+    previous(threadRasterizer) {
+    threadRasterizer = rasterizer;
+}
+
+fd::rast::RasterizerScope::~RasterizerScope() {
+    threadRasterizer = previous;
+}
+
+fd::rast::StrokeRasterizer* fd::rast::getThreadRasterizer() {
+    return threadRasterizer;
+}
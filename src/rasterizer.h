@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QPainterPath>
+#include <QTransform>
+
+namespace fd::rast {
+    enum class Kernel {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    // The fastest supported kernel is used by default, returns false if the kernel is not supported
+    bool setKernel(Kernel kernel);
+
+    class StrokeRasterizer {
+    public:
+        // Takes the pixels of an Alpha8 image, they should be obtained before a painter is opened on the image
+        StrokeRasterizer(uchar* bits, int width, int height, int bytesPerLine);
+
+        void strokePath(const QPainterPath& path, const QTransform& transform, qreal penWidth);
+
+    private:
+        uchar* bits;
+        int width, height, bytesPerLine;
+
+        void strokeSegment(const QPolygonF& polyline, int index, float radius);
+    };
+
+    class RasterizerScope {
+    public:
+        explicit RasterizerScope(StrokeRasterizer* rasterizer);
+        RasterizerScope(const RasterizerScope&) = delete;
+        RasterizerScope& operator=(const RasterizerScope&) = delete;
+
+        ~RasterizerScope();
+
+    private:
+        StrokeRasterizer* previous;
+    };
+
+    StrokeRasterizer* getThreadRasterizer();
+}
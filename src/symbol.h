@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+
+namespace fd::sym {
+    enum class Font {
+        REGULAR, VARIADIC
+    };
+
+    enum class Symbol {
+        PLUS, MINUS, DOT,
+        EQUAL, UNEQUAL, LESS, GREATER, LESS_EQUAL, GREATER_EQUAL,
+        SUM, PRODUCT, INTEGRAL,
+        COMMA, SEMICOLON, PERIOD, IF,
+        COUNT
+    };
+
+    struct SymbolInfo {
+        const char* glyph;
+        Font font;
+        double padding;
+        double yOffset;
+    };
+
+    // Indexed by Symbol, so the order must match the enum above
+    constexpr SymbolInfo symbols[] = {
+        {u8"+", Font::REGULAR, 12, 0},
+        {u8"−", Font::REGULAR, 12, 0},
+        {u8"⋅", Font::REGULAR, 12, 0},
+        {u8"=", Font::REGULAR, 12, 0},
+        {u8"≠", Font::REGULAR, 12, 0},
+        {u8"<", Font::REGULAR, 12, 0},
+        {u8">", Font::REGULAR, 12, 0},
+        {u8"≤", Font::REGULAR, 12, 0},
+        {u8"≥", Font::REGULAR, 12, 0},
+        {u8"∑", Font::VARIADIC, 12, -14},
+        {u8"∏", Font::VARIADIC, 12, -14},
+        {u8"∫", Font::VARIADIC, 12, -14},
+        {u8",", Font::REGULAR, 12, 0},
+        {u8";", Font::REGULAR, 12, 0},
+        {u8".", Font::REGULAR, 12, 0},
+        {u8"if ", Font::REGULAR, 12, 0},
+    };
+
+    constexpr size_t symbolsCount = static_cast<size_t>(Symbol::COUNT);
+    static_assert(std::size(symbols) == symbolsCount, "Every symbol should have an entry in the table");
+
+    constexpr const SymbolInfo& info(Symbol symbol) {
+        return symbols[static_cast<size_t>(symbol)];
+    }
+}
@@ -1,4 +1,87 @@
 #include "view.h"
+#include "rasterizer.h"
+#include "font_snapshot.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+// Subtrees lighter than this are cheaper to process sequentially than to hand over to a thread
+static constexpr size_t parallelWeightThreshold = 512;
+// Strokes and glyphs may stick out of the view bounds a little, so culling keeps a margin around them
+static constexpr qreal drawMargin = 16;
+
+static unsigned threadsCount = 1;
+static std::atomic<unsigned> busyThreadsCount = 0;
+// Is set while measuring the content of a SmallLayout, must be carried over to the worker threads
+static thread_local bool isTextScaled = false;
+
+void fd::v::setThreadsCount(unsigned count) {
+    threadsCount = std::max(count, 1u);
+}
+
+static std::mutex fontSnapshotMutex;
+static std::string fontSnapshotFileName;
+// Symbol metrics are cached from the snapshot, so it cannot be replaced once it has been used
+static bool isFontSnapshotUsed = false;
+
+bool fd::v::setFontSnapshotFileName(const std::string& fileName) {
+    auto lock = std::lock_guard(fontSnapshotMutex);
+    if (isFontSnapshotUsed) {
+        return fileName == fontSnapshotFileName;
+    }
+    fontSnapshotFileName = fileName;
+    return true;
+}
+
+static bool tryAcquireThread() {
+    auto busy = busyThreadsCount.load();
+    do {
+        if (busy + 1 >= threadsCount) {
+            return false;
+        }
+    } while (!busyThreadsCount.compare_exchange_weak(busy, busy + 1));
+    return true;
+}
+
+static void prepareFonts();
+
+template<typename Function>
+static void forEachIndex(size_t count, size_t weight, const Function& function) {
+    auto chunksCount = std::min<size_t>({count, threadsCount, weight / parallelWeightThreshold});
+    if (chunksCount <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            function(i);
+        }
+        return;
+    }
+
+    prepareFonts();
+    auto textScaled = isTextScaled;
+    auto processChunk = [&](size_t chunk) {
+        isTextScaled = textScaled;
+        for (size_t i = count * chunk / chunksCount; i < count * (chunk + 1) / chunksCount; i++) {
+            function(i);
+        }
+    };
+
+    auto workers = std::vector<std::thread>();
+    for (size_t chunk = 1; chunk < chunksCount; chunk++) {
+        if (tryAcquireThread()) {
+            workers.emplace_back([&processChunk, chunk] {
+                processChunk(chunk);
+                busyThreadsCount--;
+            });
+        } else {
+            processChunk(chunk);
+        }
+    }
+    processChunk(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
 
 void fd::v::View::measure() {
     onMeasure();
@@ -10,7 +93,9 @@ void fd::v::View::layout() {
 
 void fd::v::View::draw(QPainter& painter) const {
     painter.translate(x, y);
-    onDraw(painter);
+    if (!painter.hasClipping() || painter.clipBoundingRect().intersects(QRectF(-drawMargin, -drawMargin, w + 2*drawMargin, h + 2*drawMargin))) {
+        onDraw(painter);
+    }
     painter.translate(-x, -y);
 }
 
@@ -23,24 +108,100 @@ qreal fd::v::View::getCyToHeightRatio() {
 }
 
 
-static QFont& getFont(bool variadic) {
-    static auto font = QFont(QFontDatabase::applicationFontFamilies(QFontDatabase::addApplicationFont(":/opensans.ttf")).at(0));
-    static auto variadicFont = QFont(QFontDatabase::applicationFontFamilies(QFontDatabase::addApplicationFont(":/lora.ttf")).at(0));
-    if (variadic) {
-        variadicFont.setPointSizeF(100);
-        return variadicFont;
+static void ensureGuiApplication() {
+    if (!QCoreApplication::instance()) {
+        static int argc = 1;
+        static char name[] = "formula_drawer";
+        static char* argv[] = {name, nullptr};
+        new QGuiApplication(argc, argv);
     }
-    font.setPointSizeF(50);
+}
+
+static QFont loadFont(const QString& fileName, qreal pointSize) {
+    ensureGuiApplication();
+    auto font = QFont(QFontDatabase::applicationFontFamilies(QFontDatabase::addApplicationFont(fileName)).at(0));
+    font.setPointSizeF(pointSize);
     return font;
 }
 
-fd::v::TextView::TextView(const std::string& text, bool variadicSymbol):
-    text(text.c_str()), variadicSymbol(variadicSymbol) { }
+static const QFont& getFont(fd::sym::Font type) {
+    static const auto font = loadFont(":/opensans.ttf", 50);
+    static const auto variadicFont = loadFont(":/lora.ttf", 100);
+    return type == fd::sym::Font::VARIADIC ? variadicFont : font;
+}
+
+static QString getSnapshotText(fd::sym::Font type) {
+    auto text = type == fd::sym::Font::REGULAR ? QString::fromUtf8(u8"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789.+-∞?") : QString();
+    for (const auto& info : fd::sym::symbols) {
+        if (info.font == type) {
+            text += QString::fromUtf8(info.glyph);
+        }
+    }
+    return text;
+}
+
+static const fd::font::FontSnapshot* getFontSnapshot() {
+    static const auto snapshot = []() -> std::unique_ptr<fd::font::FontSnapshot> {
+        auto lock = std::lock_guard(fontSnapshotMutex);
+        isFontSnapshotUsed = true;
+        if (fontSnapshotFileName.empty()) {
+            return nullptr;
+        }
+        if (auto loaded = fd::font::FontSnapshot::load(fontSnapshotFileName)) {
+            return loaded;
+        }
+        auto fonts = std::array<QFont, 2>{getFont(fd::sym::Font::REGULAR), getFont(fd::sym::Font::VARIADIC)};
+        auto texts = std::array<QString, 2>{getSnapshotText(fd::sym::Font::REGULAR), getSnapshotText(fd::sym::Font::VARIADIC)};
+        if (!fd::font::FontSnapshot::save(fontSnapshotFileName, fonts, texts)) {
+            return nullptr;
+        }
+        return fd::font::FontSnapshot::load(fontSnapshotFileName);
+    }();
+    return snapshot.get();
+}
+
+static bool isInSnapshot(fd::sym::Font type, const QString& text) {
+    auto snapshot = getFontSnapshot();
+    return snapshot && snapshot->covers(type, text);
+}
+
+static qreal getTextWidth(fd::sym::Font type, const QString& text) {
+    if (isInSnapshot(type, text)) {
+        return getFontSnapshot()->getBoundingWidth(type, text);
+    }
+    return QFontMetricsF(getFont(type)).boundingRect(text).width();
+}
+
+static qreal getTextHeight(fd::sym::Font type) {
+    if (auto snapshot = getFontSnapshot()) {
+        return snapshot->getHeight(type);
+    }
+    return QFontMetricsF(getFont(type)).height();
+}
+
+static void drawText(QPainter& painter, fd::sym::Font type, const QRectF& rect, const QString& text) {
+    if (isInSnapshot(type, text)) {
+        auto snapshot = getFontSnapshot();
+        auto path = snapshot->getTextPath(type, text);
+        path.translate(rect.x() + (rect.width() - snapshot->getAdvanceWidth(type, text)) / 2, rect.y() + snapshot->getAscent(type));
+        painter.fillPath(path, painter.pen().brush());
+    } else {
+        painter.setFont(getFont(type));
+        painter.drawText(rect, Qt::AlignHCenter, text);
+    }
+}
+
+fd::v::TextView::TextView(const std::string& text):
+    text(QString::fromStdString(text)) {
+    // Fonts missing from the snapshot are loaded here on the parsing thread, before any worker thread is started
+    if (!isInSnapshot(fd::sym::Font::REGULAR, this->text)) {
+        getFont(fd::sym::Font::REGULAR);
+    }
+}
 
 void fd::v::TextView::onMeasure() {
-    auto fontMetrics = QFontMetricsF(getFont(variadicSymbol));
-    w = fontMetrics.boundingRect(text).width() + 12;
-    h = fontMetrics.height();
+    w = getTextWidth(fd::sym::Font::REGULAR, text) + 12;
+    h = getTextHeight(fd::sym::Font::REGULAR);
     cy = h/2;
 }
 
@@ -49,8 +210,52 @@ void fd::v::TextView::onLayout() {
 }
 
 void fd::v::TextView::onDraw(QPainter& painter) const {
-    painter.setFont(getFont(variadicSymbol));
-    painter.drawText(QRectF(0, variadicSymbol ? -14 : 0, w, h), Qt::AlignHCenter, text);
+    drawText(painter, fd::sym::Font::REGULAR, QRectF(0, 0, w, h), text);
+}
+
+
+namespace {
+    struct SymbolMetrics {
+        QString text;
+        qreal w = 0, h = 0;
+    };
+}
+
+static const SymbolMetrics& getSymbolMetrics(fd::sym::Symbol symbol) {
+    static const auto metrics = [] {
+        std::array<SymbolMetrics, fd::sym::symbolsCount> metrics;
+        for (size_t i = 0; i < fd::sym::symbolsCount; i++) {
+            const auto& info = fd::sym::symbols[i];
+            metrics[i].text = QString::fromUtf8(info.glyph);
+            metrics[i].w = getTextWidth(info.font, metrics[i].text) + info.padding;
+            metrics[i].h = getTextHeight(info.font);
+        }
+        return metrics;
+    }();
+    return metrics[static_cast<size_t>(symbol)];
+}
+
+static void prepareFonts() {
+    getSymbolMetrics(fd::sym::Symbol::PLUS);
+}
+
+fd::v::SymbolView::SymbolView(fd::sym::Symbol symbol):
+    symbol(symbol) { }
+
+void fd::v::SymbolView::onMeasure() {
+    const auto& metrics = getSymbolMetrics(symbol);
+    w = metrics.w;
+    h = metrics.h;
+    cy = h/2;
+}
+
+void fd::v::SymbolView::onLayout() {
+    // nothing to do
+}
+
+void fd::v::SymbolView::onDraw(QPainter& painter) const {
+    const auto& info = fd::sym::info(symbol);
+    drawText(painter, info.font, QRectF(0, info.yOffset, w, h), getSymbolMetrics(symbol).text);
 }
 
 
@@ -75,6 +280,15 @@ qreal fd::v::BracketView::getCyToHeightRatio() {
 }
 
 
+static void strokePath(QPainter& painter, const QPainterPath& path) {
+    auto rasterizer = fd::rast::getThreadRasterizer();
+    if (rasterizer) {
+        rasterizer->strokePath(path, painter.combinedTransform(), painter.pen().widthF());
+    } else {
+        painter.drawPath(path);
+    }
+}
+
 static void relCubicTo(QPainterPath& path, qreal dx1, qreal dy1, qreal dx2, qreal dy2, qreal dx, qreal dy) {
     auto cur = path.currentPosition();
     path.cubicTo(cur + QPointF(dx1, dy1), cur + QPointF(dx2, dy2), cur + QPointF(dx, dy));
@@ -92,7 +306,7 @@ void fd::v::OpeningRoundBracketView::onDraw(QPainter& painter) const {
     relCubicTo(path, -5.654, 5.654, -7, 12, -7, 24);
     relLineTo(path, 0, h - 76);
     relCubicTo(path, 0, 12, 1.346, 18.346, 7, 24);
-    painter.drawPath(path);
+    strokePath(painter, path);
 }
 
 fd::v::ClosingRoundBracketView::ClosingRoundBracketView():
@@ -103,7 +317,7 @@ void fd::v::ClosingRoundBracketView::onDraw(QPainter& painter) const {
     relCubicTo(path, 5.654, 5.654, 7, 12, 7, 24);
     relLineTo(path, 0, h - 76);
     relCubicTo(path, 0, 12, -1.346, 18.346, -7, 24);
-    painter.drawPath(path);
+    strokePath(painter, path);
 }
 
 fd::v::OpeningCurlyBracketView::OpeningCurlyBracketView():
@@ -118,12 +332,14 @@ void fd::v::OpeningCurlyBracketView::onDraw(QPainter& painter) const {
     relCubicTo(path, 8.0028, 0, 11, 3.9987, 11, 12);
     relLineTo(path, 0, verticalElementLength);
     relCubicTo(path, 0, 7.995, 3.0025, 10.381, 11, 10.5);
-    painter.drawPath(path);
+    strokePath(painter, path);
 }
 
 
 fd::v::ScaleLayout::ScaleLayout(std::unique_ptr<View> child, qreal factor):
-    child(std::move(child)), factor(factor) { }
+    child(std::move(child)), factor(factor) {
+    weight += this->child->weight;
+}
 
 void fd::v::ScaleLayout::onMeasure() {
     child->measure();
@@ -146,10 +362,11 @@ void fd::v::ScaleLayout::onDraw(QPainter& painter) const {
 
 
 fd::v::SmallLayout::SmallLayout(std::unique_ptr<View> child, fd::v::SmallLayoutType type)
-    : child(std::make_unique<ScaleLayout>(std::move(child), 1)), type(type) { }
+    : child(std::make_unique<ScaleLayout>(std::move(child), 1)), type(type) {
+    weight += this->child->weight;
+}
 
 void fd::v::SmallLayout::onMeasure() {
-    static auto isTextScaled = false;
     if (isTextScaled) {
         child->factor = 1;
         child->measure();
@@ -176,9 +393,19 @@ void fd::v::SmallLayout::onDraw(QPainter& painter) const {
 
 
 fd::v::HorizontalLayout::HorizontalLayout(std::vector<std::unique_ptr<View>> children):
-    children(std::move(children)) { }
+    children(std::move(children)) {
+    for (const auto& child : this->children) {
+        weight += child->weight;
+    }
+}
 
 void fd::v::HorizontalLayout::onMeasure() {
+    forEachIndex(children.size(), weight, [this](size_t i) {
+        if (children[i]->isHeightSpecified()) {
+            children[i]->measure();
+        }
+    });
+
     w = 0;
     cy = 0;
     qreal hMinusCy = 0;
@@ -186,7 +413,6 @@ void fd::v::HorizontalLayout::onMeasure() {
         if (!child->isHeightSpecified()) {
             continue;
         }
-        child->measure();
         w += child->w;
         cy = std::max(cy, child->cy);
         hMinusCy = std::max(hMinusCy, child->h - child->cy);
@@ -204,9 +430,12 @@ void fd::v::HorizontalLayout::onMeasure() {
 }
 
 void fd::v::HorizontalLayout::onLayout() {
+    forEachIndex(children.size(), weight, [this](size_t i) {
+        children[i]->layout();
+    });
+
     qreal currentX = 0;
     for (auto& child : children) {
-        child->layout();
         child->x = currentX;
         currentX += child->w;
         child->y = cy - child->cy;
@@ -221,7 +450,9 @@ void fd::v::HorizontalLayout::onDraw(QPainter& painter) const {
 
 
 fd::v::FractionLayout::FractionLayout(std::unique_ptr<View> num, std::unique_ptr<View> den):
-    num(std::move(num)), den(std::move(den)) { }
+    num(std::move(num)), den(std::move(den)) {
+    weight += this->num->weight + this->den->weight;
+}
 
 void fd::v::FractionLayout::onMeasure() {
     num->measure();
@@ -242,13 +473,17 @@ void fd::v::FractionLayout::onLayout() {
 
 void fd::v::FractionLayout::onDraw(QPainter& painter) const {
     num->draw(painter);
-    painter.drawLine(QLineF(4, cy, w-4, cy));
+    QPainterPath path(QPointF(4, cy));
+    path.lineTo(w-4, cy);
+    strokePath(painter, path);
     den->draw(painter);
 }
 
 
 fd::v::TripleVerticalLayout::TripleVerticalLayout(std::unique_ptr<View> top, std::unique_ptr<View> center, std::unique_ptr<View> bottom):
-    top(std::move(top)), center(std::move(center)), bottom(std::move(bottom)) { }
+    top(std::move(top)), center(std::move(center)), bottom(std::move(bottom)) {
+    weight += this->top->weight + this->center->weight + this->bottom->weight;
+}
 
 void fd::v::TripleVerticalLayout::onMeasure() {
     top->measure();
@@ -279,7 +514,13 @@ void fd::v::TripleVerticalLayout::onDraw(QPainter& painter) const {
 
 
 fd::v::GridLayout::GridLayout(std::vector<std::vector<std::unique_ptr<View>>> rows, bool alignCenter):
-    rows(std::move(rows)), alignCenter(alignCenter) { }
+    rows(std::move(rows)), alignCenter(alignCenter) {
+    for (const auto& row : this->rows) {
+        for (const auto& view : row) {
+            weight += view->weight;
+        }
+    }
+}
 
 void fd::v::GridLayout::onMeasure() {
     w = 0;
@@ -289,6 +530,12 @@ void fd::v::GridLayout::onMeasure() {
         return;
     }
 
+    forEachIndex(rows.size(), weight, [this](size_t i) {
+        for (auto& view : rows[i]) {
+            view->measure();
+        }
+    });
+
     rowHeights.clear();
     rowCys.clear();
     size_t columnsCount = 0;
@@ -296,7 +543,6 @@ void fd::v::GridLayout::onMeasure() {
     for (const auto& row : rows) {
         qreal currentCy = 0, currentHMinusCy = 0;
         for (auto& view : row) {
-            view->measure();
             currentCy = std::max(currentCy, view->cy);
             currentHMinusCy = std::max(currentHMinusCy, view->h - view->cy);
         }
@@ -325,11 +571,16 @@ void fd::v::GridLayout::onMeasure() {
 }
 
 void fd::v::GridLayout::onLayout() {
+    forEachIndex(rows.size(), weight, [this](size_t i) {
+        for (auto& view : rows[i]) {
+            view->layout();
+        }
+    });
+
     qreal currentY = 0;
     for (int i = 0; i < rows.size(); i++) {
         qreal currentX = 0;
         for (int j = 0; j < rows[i].size(); j++) {
-            rows[i][j]->layout();
             rows[i][j]->x = currentX + (alignCenter ? (columnWidths[j] - rows[i][j]->w) / 2 : 12);
             currentX += columnWidths[j];
             rows[i][j]->y = currentY + rowCys[i] - rows[i][j]->cy;
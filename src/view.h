@@ -1,13 +1,20 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
 #include <QtWidgets>
+#include "symbol.h"
 
 namespace fd::v {
+    void setThreadsCount(unsigned count);
+
+    bool setFontSnapshotFileName(const std::string& fileName);
+
     class View {
     public:
         qreal x = 0, y = 0, w = 0, h = 0, cy = 0;
+        size_t weight = 1;
 
         void measure();
         void layout();
@@ -26,9 +33,19 @@ namespace fd::v {
     class TextView : public View {
     public:
         QString text;
-        bool variadicSymbol = false;
 
-        explicit TextView(const std::string& text, bool variadicSymbol = false);
+        explicit TextView(const std::string& text);
+
+        void onMeasure() override;
+        void onLayout() override;
+        void onDraw(QPainter& painter) const override;
+    };
+
+    class SymbolView : public View {
+    public:
+        fd::sym::Symbol symbol;
+
+        explicit SymbolView(fd::sym::Symbol symbol);
 
         void onMeasure() override;
         void onLayout() override;
@@ -99,6 +116,8 @@ namespace fd::v {
     class HorizontalLayout : public View {
     public:
         std::vector<std::unique_ptr<View>> children;
+        // Set for the operands and signs of unary and binary operators, which are separate tokens of the formula
+        bool isOperatorChain = false;
 
         explicit HorizontalLayout(std::vector<std::unique_ptr<View>> children);
 
@@ -0,0 +1,45 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <formula_drawer.h>
+
+static int failuresCount = 0;
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        failuresCount++;
+    }
+}
+
+int main() {
+    auto outputFileName = QDir::temp().filePath("formula_drawer_metrics_test.png");
+    auto options = fd::Options();
+    options.tokenBoxes = true;
+
+    auto expectedBoxesCounts = std::vector<std::pair<std::string, size_t>>{
+        {"a", 1},
+        {"a + b", 3},
+        {"-a * b", 4},
+        {"(a + b)^2 + c", 3},
+        {"a[i + 1] = (b - c)", 3},
+        {"sum(i, 1, n) + x", 3},
+        {"a/(b + c)", 1},
+    };
+    for (const auto& [expression, boxesCount] : expectedBoxesCounts) {
+        auto result = fd::drawExpression(expression, outputFileName.toStdString(), options);
+        check(result.accepted, expression + " is rejected: " + result.errorMessage);
+        check(result.boxes.size() == boxesCount,
+            expression + " has " + std::to_string(result.boxes.size()) + " token boxes instead of " + std::to_string(boxesCount));
+
+        auto image = QImage(outputFileName);
+        check(image.width() == result.width && image.height() == result.height,
+            expression + " reports a size different from the size of its image");
+    }
+
+    QFile::remove(outputFileName);
+    return failuresCount == 0 ? 0 : 1;
+}
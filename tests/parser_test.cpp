@@ -0,0 +1,53 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <QDir>
+#include <QFile>
+#include <formula_drawer.h>
+
+static int failuresCount = 0;
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        failuresCount++;
+    }
+}
+
+int main() {
+    auto outputFileName = QDir::temp().filePath("formula_drawer_parser_test.png").toStdString();
+
+    auto unclosedExpressions = std::vector<std::string>{
+        "(a", "sum(a, b", "a[b", "matrix((a)", "cases(a, b", "((a + b", "int(a, b, (c"
+    };
+    for (const auto& expression : unclosedExpressions) {
+        auto result = fd::drawExpression(expression, outputFileName);
+        check(!result.accepted, expression + " is accepted");
+        check(!result.diagnostics.empty(), expression + " has no diagnostics");
+    }
+
+    auto result = fd::drawExpression("(a + b", outputFileName);
+    check(result.diagnostics.size() == 1 && result.diagnostics[0].line == 1 && result.diagnostics[0].column == 7,
+        "unexpected end of input is not reported at 1:7");
+
+    result = fd::drawExpression("(a]) + b[)]", outputFileName);
+    check(result.diagnostics.size() == 2, "errors after a recovered one are not reported");
+
+    result = fd::drawExpression("a b + (c]", outputFileName);
+    check(result.diagnostics.size() == 2 && result.diagnostics[0].column == 3 && result.diagnostics[1].column == 9,
+        "two top-level errors are not both reported at 1:3 and 1:9");
+
+    result = fd::drawExpression("a) b] c", outputFileName);
+    check(result.diagnostics.size() == 2, "errors after a recovered top-level one are not reported");
+
+    result = fd::drawExpression("matrix((a, b), (c))", outputFileName);
+    check(!result.accepted, "a matrix with rows of different lengths is accepted");
+
+    for (const auto& expression : {"(a)", "a[b] + sum(i, 1, n)", "matrix((a, b), (c, d))"}) {
+        result = fd::drawExpression(expression, outputFileName);
+        check(result.accepted, std::string(expression) + " is rejected: " + result.errorMessage);
+    }
+
+    QFile::remove(QString::fromStdString(outputFileName));
+    return failuresCount == 0 ? 0 : 1;
+}
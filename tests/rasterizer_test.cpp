@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <formula_drawer.h>
+#include <rasterizer.h>
+
+static constexpr double pi = 3.14159265358979323846;
+// Native strokes differ from the exact coverage of the same outline by up to 34, bevels and caps included
+static constexpr int maxPixelDifference = 40;
+// Where the arms of a curly bracket meet both cover the same pixels, and their coverage combined with max falls
+// short of the union by up to a third, so a few pixels at the tip may differ more
+static constexpr int maxOutlyingPixelsCount = 6;
+static constexpr double maxMeanDifference = 0.25;
+
+static int failuresCount = 0;
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        failuresCount++;
+    }
+}
+
+static const std::vector<std::pair<fd::rast::Kernel, std::string>> kernels = {
+    {fd::rast::Kernel::SCALAR, "scalar"},
+    {fd::rast::Kernel::SSE2, "sse2"},
+    {fd::rast::Kernel::AVX2, "avx2"},
+};
+
+static std::vector<uchar> strokeTestPaths(double scale) {
+    const int width = 320, height = 240;
+    auto pixels = std::vector<uchar>(width * height);
+    auto rasterizer = fd::rast::StrokeRasterizer(pixels.data(), width, height, width);
+
+    auto path = QPainterPath();
+    for (int i = 0; i < 24; i++) {
+        auto angle = i * pi / 12 + 0.1;
+        path.moveTo(150.25 + i * 0.125, 110.5);
+        path.lineTo(150.25 + i * 0.125 + 90 * std::cos(angle), 110.5 + 90 * std::sin(angle));
+    }
+    // Pixels of the row at y = 10 are covered by exactly 254.5 / 255, kernels must round such ties the same way
+    path.moveTo(10.5, 8.9980392456054688);
+    path.lineTo(300, 8.9980392456054688);
+    path.moveTo(20, 230);
+    path.cubicTo(40, 120.3, 60.7, 120.3, 80, 230);
+    auto transform = QTransform::fromScale(scale, scale);
+    rasterizer.strokePath(path, transform, 4);
+    return pixels;
+}
+
+// Every kernel must produce exactly the same bytes as the scalar one
+static void checkKernelsMatch() {
+    for (auto scale : {1.0, 0.5, 0.7}) {
+        fd::rast::setKernel(fd::rast::Kernel::SCALAR);
+        auto expected = strokeTestPaths(scale);
+        for (const auto& [kernel, name] : kernels) {
+            if (!fd::rast::setKernel(kernel)) {
+                std::cout << "Skipping the unsupported " << name << " kernel" << std::endl;
+                continue;
+            }
+            check(strokeTestPaths(scale) == expected, name + " kernel differs from the scalar one at scale " + std::to_string(scale));
+        }
+    }
+}
+
+static QImage drawCoverage(const std::string& expression, bool nativeStrokes) {
+    auto fileName = QDir::temp().filePath("formula_drawer_rasterizer_test.png");
+    auto options = fd::Options();
+    options.renderTarget = fd::RenderTarget::COVERAGE;
+    options.nativeStrokes = nativeStrokes;
+    auto result = fd::drawExpression(expression, fileName.toStdString(), options);
+    check(result.accepted, expression + " is rejected: " + result.errorMessage);
+    auto image = QImage(fileName).convertToFormat(QImage::Format_Grayscale8);
+    QFile::remove(fileName);
+    return image;
+}
+
+// Native strokes must look like the strokes of QPainter
+static void checkNativeMatchesQt() {
+    // Fraction lines and every bracket at a few heights, and scaled down inside powers and indices
+    auto expressions = std::vector<std::string>{
+        "a/b",
+        "(a/b)/(c/d)",
+        "(a)",
+        "((a/b))",
+        "(((a/b)/(c/d)))",
+        "a^(b/c)",
+        "a[(b/c)]",
+        "cases(a, b)",
+        "cases(a, b, c/d, e, f, g)",
+        "x^cases(a/b, c)",
+        "matrix((a/b, c), (d, e))",
+    };
+    for (const auto& [kernel, name] : kernels) {
+        if (!fd::rast::setKernel(kernel)) {
+            continue;
+        }
+        for (const auto& expression : expressions) {
+            auto expected = drawCoverage(expression, false);
+            auto actual = drawCoverage(expression, true);
+            if (expected.size() != actual.size()) {
+                check(false, expression + " has a different size with native strokes");
+                continue;
+            }
+
+            int maxDifference = 0, outlyingPixelsCount = 0;
+            double differenceSum = 0;
+            for (int y = 0; y < expected.height(); y++) {
+                auto expectedLine = expected.constScanLine(y);
+                auto actualLine = actual.constScanLine(y);
+                for (int x = 0; x < expected.width(); x++) {
+                    auto difference = std::abs(expectedLine[x] - actualLine[x]);
+                    if (difference > maxPixelDifference) {
+                        outlyingPixelsCount++;
+                    }
+                    maxDifference = std::max(maxDifference, difference);
+                    differenceSum += difference;
+                }
+            }
+            auto meanDifference = differenceSum / (expected.width() * expected.height());
+            check(outlyingPixelsCount <= maxOutlyingPixelsCount && meanDifference <= maxMeanDifference,
+                expression + " with the " + name + " kernel differs from QPainter by up to " + std::to_string(maxDifference)
+                + " in " + std::to_string(outlyingPixelsCount) + " pixels, " + std::to_string(meanDifference) + " on average");
+        }
+    }
+}
+
+int main() {
+    checkKernelsMatch();
+    checkNativeMatchesQt();
+    return failuresCount == 0 ? 0 : 1;
+}